@@ -6,10 +6,22 @@
 #define SHA1_SIZE   (20)
 #define NAME_LEN    (128)
 
+#ifdef ILC_COUNT_ALLOCS
+unsigned long gIlcAllocCount = 0;
+#endif
+
+static INIT_ONCE mCryptProviderInitOnce = INIT_ONCE_STATIC_INIT;
 static HCRYPTPROV mCryptProvider = 0;
 
-static void freeSource(
-    Source* src);
+static BOOL CALLBACK initCryptProvider(
+    PINIT_ONCE initOnce,
+    PVOID param,
+    PVOID* context)
+{
+    // This function is very slow (~250ms), acquire once
+    CryptAcquireContext(&mCryptProvider, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
+    return TRUE;
+}
 
 static void calcSha1(
     uint8_t* digest,
@@ -20,10 +32,8 @@ static void calcSha1(
     DWORD digestSize = 0;
     DWORD dwordSize = sizeof(DWORD);
 
-    if (mCryptProvider == 0) {
-        // This function is very slow (~250ms), acquire once
-        CryptAcquireContext(&mCryptProvider, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT);
-    }
+    // Shaders may be compiled from multiple threads
+    InitOnceExecuteOnce(&mCryptProviderInitOnce, initCryptProvider, NULL, NULL);
 
     CryptCreateHash(mCryptProvider, CALG_SHA1, 0, 0, &hash);
     CryptHashData(hash, data, size, 0);
@@ -33,50 +43,59 @@ static void calcSha1(
     CryptDestroyHash(hash);
 }
 
-static void freeDestination(
-    Destination* dst)
+static void freeKernel(
+    Kernel* kernel)
 {
-    if (dst->absoluteSrc != NULL) {
-        freeSource(dst->absoluteSrc);
-    }
-    free(dst->absoluteSrc);
+    // The decoder allocates the kernel and its IR as a single block
+    free(kernel);
 }
 
-static void freeSource(
-    Source* src)
+static bool isShaderDumpEnabled()
 {
-    for (unsigned i = 0; i < src->srcCount; i++) {
-        freeSource(&src->srcs[i]);
-    }
-    free(src->srcs);
+    const char* envValue = getenv("GRVK_DUMP_SHADERS");
+
+    return envValue != NULL && strcmp(envValue, "1") == 0;
 }
 
-static void freeInstruction(
-    Instruction* instr)
+static bool isSsaEnabled()
 {
-    for (unsigned i = 0; i < instr->dstCount; i++) {
-        freeDestination(&instr->dsts[i]);
-    }
-    for (unsigned i = 0; i < instr->srcCount; i++) {
-        freeSource(&instr->srcs[i]);
-    }
-    free(instr->dsts);
-    free(instr->srcs);
-    free(instr->extras);
+    const char* envValue = getenv("GRVK_SHADER_SSA");
+
+    return envValue != NULL && strcmp(envValue, "1") == 0;
 }
 
-static void freeKernel(
-    Kernel* kernel)
+static bool isDebugInfoEnabled()
 {
-    for (unsigned i = 0; i < kernel->instrCount; i++) {
-        freeInstruction(&kernel->instrs[i]);
-    }
-    free(kernel->instrs);
+    const char* envValue = getenv("GRVK_SHADER_DEBUG_INFO");
+
+    // Dumped shaders are meant to be inspected
+    return (envValue != NULL && strcmp(envValue, "1") == 0) || isShaderDumpEnabled();
 }
 
-static bool isShaderDumpEnabled()
+static bool isCollapseMovsEnabled()
 {
-    const char* envValue = getenv("GRVK_DUMP_SHADERS");
+    const char* envValue = getenv("GRVK_SHADER_COLLAPSE_MOVS");
+
+    return envValue != NULL && strcmp(envValue, "1") == 0;
+}
+
+static bool isRemoveDeadTempsEnabled()
+{
+    const char* envValue = getenv("GRVK_SHADER_REMOVE_DEAD_TEMPS");
+
+    return envValue != NULL && strcmp(envValue, "1") == 0;
+}
+
+static bool isRemoveRedundantDclsEnabled()
+{
+    const char* envValue = getenv("GRVK_SHADER_REMOVE_REDUNDANT_DCLS");
+
+    return envValue != NULL && strcmp(envValue, "1") == 0;
+}
+
+static bool isSpecializeLinkConstsEnabled()
+{
+    const char* envValue = getenv("GRVK_SHADER_SPECIALIZE_LINK_CONSTS");
 
     return envValue != NULL && strcmp(envValue, "1") == 0;
 }
@@ -127,30 +146,70 @@ static void dumpKernel(
     fclose(file);
 }
 
+unsigned ilcGetOptions()
+{
+    unsigned options = 0;
+
+    if (isSsaEnabled()) {
+        options |= ILC_OPTION_SSA;
+    }
+    if (isDebugInfoEnabled()) {
+        options |= ILC_OPTION_DEBUG_INFO;
+    }
+    if (isCollapseMovsEnabled()) {
+        options |= ILC_OPTION_COLLAPSE_MOVS;
+    }
+    if (isRemoveDeadTempsEnabled()) {
+        options |= ILC_OPTION_REMOVE_DEAD_TEMPS;
+    }
+    if (isRemoveRedundantDclsEnabled()) {
+        options |= ILC_OPTION_REMOVE_REDUNDANT_DCLS;
+    }
+    if (isSpecializeLinkConstsEnabled()) {
+        options |= ILC_OPTION_SPECIALIZE_LINK_CONSTS;
+    }
+
+    return options;
+}
+
 IlcShader ilcCompileShader(
     const void* code,
     unsigned size)
 {
     char name[NAME_LEN];
     getShaderName(name, NAME_LEN, code, size);
+
+    bool dump = isShaderDumpEnabled();
+    IlcShader shader;
+
+    // Bypass the cache when dumping so that all intermediate files get written
+    if (!dump && ilcCacheLoad(&shader, name, size)) {
+        return shader;
+    }
+
     LOGV("compiling %s...\n", name);
 
     Kernel* kernel = ilcDecodeStream((Token*)code, size / sizeof(Token));
-    bool dump = isShaderDumpEnabled();
 
     if (dump) {
         dumpBuffer(code, size, name, "il");
+    }
+
+    ilcOptimizeKernel(kernel, name);
+
+    if (dump) {
         dumpKernel(kernel, name);
     }
 
-    IlcShader shader = ilcCompileKernel(kernel, name);
+    shader = ilcCompileKernel(kernel, name);
 
     if (dump) {
         dumpBuffer((uint8_t*)shader.code, shader.codeSize, name, "spv");
     }
 
+    ilcCacheStore(&shader, name, size);
+
     freeKernel(kernel);
-    free(kernel);
     return shader;
 }
 
@@ -163,5 +222,4 @@ void ilcDisassembleShader(
 
     ilcDumpKernel(file, kernel);
     freeKernel(kernel);
-    free(kernel);
 }
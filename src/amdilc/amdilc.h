@@ -9,6 +9,11 @@
 // TODO get rid of this
 #define ILC_BASE_RESOURCE_ID    (16) // Samplers use 0-15
 
+// Link-time constants are exposed as specialization constants, one per dword of a constant
+// buffer, and only used when the flag of their constant buffer is specialized to true
+#define ILC_LINK_CONST_SPEC_ID(bufferId, dwordIndex) (((bufferId) << 16) | (dwordIndex))
+#define ILC_LINK_CONST_FLAG_SPEC_ID(bufferId)        (((bufferId) << 16) | 0xFFFF)
+
 typedef struct _IlcBinding {
     uint32_t index;
     VkDescriptorType descriptorType;
@@ -0,0 +1,230 @@
+#include <windows.h>
+#include "amdilc_internal.h"
+
+#define CACHE_MAGIC     (0x43434C49) // "ILCC"
+#define PATH_LEN        (512)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t revision;
+    uint32_t options; // IlcOption flags the shader was compiled with
+    uint32_t ilSize;
+    uint32_t codeSize;
+    uint32_t bindingCount;
+} IlcCacheHeader;
+
+typedef struct {
+    uint32_t index;
+    uint32_t descriptorType;
+} IlcCacheBinding;
+
+// Shaders may be compiled from multiple threads
+static volatile LONG mCacheHitCount = 0;
+static volatile LONG mCacheMissCount = 0;
+static volatile LONG mCacheBytesRead = 0;
+static volatile LONG mCacheBytesWritten = 0;
+
+static const char* getCachePath()
+{
+    const char* envValue = getenv("GRVK_SHADER_CACHE_PATH");
+
+    return envValue != NULL && strlen(envValue) > 0 ? envValue : NULL;
+}
+
+static void getCacheFileName(
+    char* fileName,
+    unsigned fileNameLen,
+    const char* cachePath,
+    const char* name)
+{
+    snprintf(fileName, fileNameLen, "%s/%s.ilc", cachePath, name);
+}
+
+static void logCacheStats()
+{
+    LOGD("hits %ld, misses %ld, %ld bytes read, %ld bytes written\n",
+         mCacheHitCount, mCacheMissCount, mCacheBytesRead, mCacheBytesWritten);
+}
+
+bool ilcCacheIsEnabled()
+{
+    return getCachePath() != NULL;
+}
+
+unsigned ilcCacheSerialize(
+    uint8_t** data,
+    const IlcShader* shader,
+    unsigned ilSize)
+{
+    unsigned size = sizeof(IlcCacheHeader) + shader->codeSize +
+                    shader->bindingCount * sizeof(IlcCacheBinding);
+    uint8_t* ptr = malloc(size);
+
+    *data = ptr;
+
+    const IlcCacheHeader header = {
+        .magic = CACHE_MAGIC,
+        .revision = ILC_COMPILER_REVISION,
+        .options = ilcGetOptions(),
+        .ilSize = ilSize,
+        .codeSize = shader->codeSize,
+        .bindingCount = shader->bindingCount,
+    };
+
+    memcpy(ptr, &header, sizeof(header));
+    ptr += sizeof(header);
+    memcpy(ptr, shader->code, shader->codeSize);
+    ptr += shader->codeSize;
+
+    for (unsigned i = 0; i < shader->bindingCount; i++) {
+        const IlcCacheBinding binding = {
+            .index = shader->bindings[i].index,
+            .descriptorType = shader->bindings[i].descriptorType,
+        };
+
+        memcpy(ptr, &binding, sizeof(binding));
+        ptr += sizeof(binding);
+    }
+
+    return size;
+}
+
+bool ilcCacheDeserialize(
+    IlcShader* shader,
+    const uint8_t* data,
+    unsigned size,
+    unsigned ilSize)
+{
+    IlcCacheHeader header;
+
+    if (size < sizeof(header)) {
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    if (header.magic != CACHE_MAGIC || header.revision != ILC_COMPILER_REVISION ||
+        header.options != ilcGetOptions() || header.ilSize != ilSize ||
+        (header.codeSize % sizeof(uint32_t)) != 0 ||
+        size != sizeof(header) + header.codeSize + header.bindingCount * sizeof(IlcCacheBinding)) {
+        return false;
+    }
+
+    const uint8_t* ptr = data + sizeof(header);
+
+    *shader = (IlcShader) {
+        .codeSize = header.codeSize,
+        .code = malloc(header.codeSize),
+        .bindingCount = header.bindingCount,
+        .bindings = malloc(header.bindingCount * sizeof(IlcBinding)),
+    };
+
+    memcpy(shader->code, ptr, header.codeSize);
+    ptr += header.codeSize;
+
+    for (unsigned i = 0; i < header.bindingCount; i++) {
+        IlcCacheBinding binding;
+
+        memcpy(&binding, ptr, sizeof(binding));
+        ptr += sizeof(binding);
+
+        shader->bindings[i] = (IlcBinding) {
+            .index = binding.index,
+            .descriptorType = binding.descriptorType,
+        };
+    }
+
+    return true;
+}
+
+bool ilcCacheLoad(
+    IlcShader* shader,
+    const char* name,
+    unsigned ilSize)
+{
+    const char* cachePath = getCachePath();
+    char fileName[PATH_LEN];
+    bool hit = false;
+
+    if (cachePath == NULL) {
+        return false;
+    }
+
+    getCacheFileName(fileName, PATH_LEN, cachePath, name);
+
+    FILE* file = fopen(fileName, "rb");
+    if (file != NULL) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        if (size > 0) {
+            uint8_t* data = malloc(size);
+
+            if (fread(data, 1, size, file) == (size_t)size) {
+                hit = ilcCacheDeserialize(shader, data, size, ilSize);
+            }
+            if (hit) {
+                InterlockedExchangeAdd(&mCacheBytesRead, size);
+            } else {
+                LOGW("ignoring stale or corrupted cache entry %s\n", fileName);
+            }
+
+            free(data);
+        }
+
+        fclose(file);
+    }
+
+    if (hit) {
+        InterlockedIncrement(&mCacheHitCount);
+    } else {
+        InterlockedIncrement(&mCacheMissCount);
+    }
+
+    LOGV("%s %s\n", name, hit ? "hit" : "miss");
+    logCacheStats();
+    return hit;
+}
+
+void ilcCacheStore(
+    const IlcShader* shader,
+    const char* name,
+    unsigned ilSize)
+{
+    const char* cachePath = getCachePath();
+    char fileName[PATH_LEN];
+    char tempFileName[PATH_LEN];
+
+    if (cachePath == NULL) {
+        return;
+    }
+
+    CreateDirectoryA(cachePath, NULL);
+    getCacheFileName(fileName, PATH_LEN, cachePath, name);
+    snprintf(tempFileName, PATH_LEN, "%s.%lu.tmp", fileName, GetCurrentThreadId());
+
+    uint8_t* data = NULL;
+    unsigned size = ilcCacheSerialize(&data, shader, ilSize);
+
+    // Write to a temporary file first so that readers never see partial entries
+    FILE* file = fopen(tempFileName, "wb");
+    if (file == NULL) {
+        LOGW("failed to open %s for writing\n", tempFileName);
+        free(data);
+        return;
+    }
+
+    bool written = fwrite(data, 1, size, file) == size;
+    fclose(file);
+    free(data);
+
+    if (!written || !MoveFileExA(tempFileName, fileName, MOVEFILE_REPLACE_EXISTING)) {
+        LOGW("failed to write %s\n", fileName);
+        remove(tempFileName);
+        return;
+    }
+
+    InterlockedExchangeAdd(&mCacheBytesWritten, size);
+    logCacheStats();
+}
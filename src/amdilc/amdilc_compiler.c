@@ -7,6 +7,9 @@
 #define FALSE_LITERAL       (0x00000000)
 #define TRUE_LITERAL        (0xFFFFFFFF)
 #define SHIFT_MASK_LITERAL  (0x1F)
+#define SIGN_MASK_LITERAL   (0x80000000)
+#define MAX_CB_SIZE         (4096)
+#define MAX_CACHED_SOURCES  (64)
 #define COMP_INDEX_X        (0)
 #define COMP_INDEX_Y        (1)
 #define COMP_INDEX_Z        (2)
@@ -38,8 +41,28 @@ typedef struct {
     uint32_t ilNum;
     uint8_t ilImportUsage; // Input/output only
     uint8_t ilInterpMode; // Input only
+    const Token* constantValues; // Literal and immediate constant buffer only
+    unsigned constantCount; // Number of vec4 constants
 } IlcRegister;
 
+typedef struct {
+    unsigned count;
+    unsigned* indices; // Index in the register list plus one, 0 if absent
+} IlcRegisterMap;
+
+typedef struct {
+    unsigned regIndex;
+    uint32_t immediate;
+    uint8_t swizzle[4];
+    bool negate[4];
+    bool abs;
+    bool hasImmediate;
+    uint8_t componentMask;
+    bool isPacked;
+    IlcSpvId typeId;
+    IlcSpvId id; // Loaded value
+} IlcCachedSource;
+
 typedef struct {
     IlcResourceType resType;
     IlcSpvId id;
@@ -48,6 +71,7 @@ typedef struct {
     uint32_t ilId;
     uint8_t ilType;
     IlcSpvId strideId;
+    bool isVectorized; // Buffer words are grouped in 16-byte vector elements
 } IlcResource;
 
 typedef struct {
@@ -55,16 +79,36 @@ typedef struct {
     uint32_t ilId;
 } IlcSampler;
 
+typedef struct {
+    IlcSpvWord specId; // Of the first component for vectors
+    IlcSpvId id;
+} IlcSpecConstant;
+
+typedef struct {
+    IlcSpvId labelId; // Block the values flow from
+    unsigned valueCount;
+    IlcSpvId* values; // SSA temporary values, indexed like the register list
+} IlcSsaState;
+
 typedef struct {
     IlcSpvId labelElseId;
     IlcSpvId labelEndId;
     bool hasElseBlock;
+    IlcSsaState ssaIfState; // Before the if block
+    IlcSsaState ssaThenState; // At the end of the if block
 } IlcIfElseBlock;
 
 typedef struct {
     IlcSpvId labelHeaderId;
     IlcSpvId labelContinueId;
     IlcSpvId labelBreakId;
+    unsigned ssaTempCount;
+    unsigned* ssaTempIndices; // SSA temporaries written inside the loop
+    IlcSpvId* ssaContinueIds; // Values of these temporaries in the continue block
+    unsigned ssaContinueStateCount;
+    IlcSsaState* ssaContinueStates;
+    unsigned ssaBreakStateCount;
+    IlcSsaState* ssaBreakStates;
 } IlcLoopBlock;
 
 typedef struct {
@@ -90,11 +134,22 @@ typedef struct {
     IlcSpvId boolId;
     IlcSpvId bool4Id;
     unsigned regCount;
+    unsigned regCapacity;
     IlcRegister* regs;
+    IlcRegisterMap regMaps[IL_REGTYPE_LAST];
+    bool isSsaEnabled;
+    bool hasDebugInfo;
+    bool isLinkConstSpecEnabled;
+    IlcSpvId* ssaValues; // Current value of each SSA temporary, indexed like the register list
+    IlcSpvId currentLabelId;
+    unsigned cachedSourceCount;
+    IlcCachedSource cachedSources[MAX_CACHED_SOURCES]; // Sources loaded in the current block
     unsigned resourceCount;
     IlcResource* resources;
     unsigned samplerCount;
     IlcSampler* samplers;
+    unsigned specConstantCount;
+    IlcSpecConstant* specConstants;
     unsigned controlFlowBlockCount;
     IlcControlFlowBlock* controlFlowBlocks;
     bool isInFunction;
@@ -190,17 +245,105 @@ static IlcSpvId emitZeroOneVector(
     return ilcSpvPutConstantComposite(compiler->module, vec2Id, 2, consistuentIds);
 }
 
+static unsigned getComponentCount(
+    uint8_t componentMask)
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < 4; i++) {
+        count += GET_BIT(componentMask, i);
+    }
+
+    return count;
+}
+
+static IlcSpvId getComponentTypeId(
+    IlcCompiler* compiler,
+    IlcSpvId vec4TypeId)
+{
+    if (vec4TypeId == compiler->float4Id) {
+        return compiler->floatId;
+    } else if (vec4TypeId == compiler->uint4Id) {
+        return compiler->uintId;
+    } else if (vec4TypeId == compiler->int4Id) {
+        return compiler->intId;
+    }
+
+    assert(false);
+    return 0;
+}
+
+static IlcSpvId emitVectorType(
+    IlcCompiler* compiler,
+    IlcSpvId componentTypeId,
+    unsigned componentCount)
+{
+    assert(1 <= componentCount && componentCount <= 4);
+
+    // Single components are kept as scalars
+    return componentCount == 1 ? componentTypeId :
+           ilcSpvPutVectorType(compiler->module, componentTypeId, componentCount);
+}
+
+static IlcSpvId emitConstantVector(
+    IlcCompiler* compiler,
+    IlcSpvId componentTypeId,
+    IlcSpvWord literal,
+    unsigned componentCount)
+{
+    IlcSpvId constantId = ilcSpvPutConstant(compiler->module, componentTypeId, literal);
+
+    if (componentCount == 1) {
+        return constantId;
+    }
+
+    const IlcSpvId consistuentIds[] = { constantId, constantId, constantId, constantId };
+    return ilcSpvPutConstantComposite(compiler->module,
+                                      emitVectorType(compiler, componentTypeId, componentCount),
+                                      componentCount, consistuentIds);
+}
+
+static IlcSpvId emitVectorSplat(
+    IlcCompiler* compiler,
+    IlcSpvId scalarId,
+    IlcSpvId componentTypeId,
+    unsigned componentCount)
+{
+    if (componentCount == 1) {
+        return scalarId;
+    }
+
+    const IlcSpvId consistuentIds[] = { scalarId, scalarId, scalarId, scalarId };
+    return ilcSpvPutCompositeConstruct(compiler->module,
+                                       emitVectorType(compiler, componentTypeId, componentCount),
+                                       componentCount, consistuentIds);
+}
+
+static IlcSpvId emitPackedComponent(
+    IlcCompiler* compiler,
+    IlcSpvId vecId,
+    IlcSpvId componentTypeId,
+    unsigned componentCount,
+    unsigned index)
+{
+    if (componentCount == 1) {
+        return vecId;
+    }
+
+    return ilcSpvPutCompositeExtract(compiler->module, componentTypeId, vecId, 1, &index);
+}
+
 static IlcSpvId emitShiftMask(
     IlcCompiler* compiler,
-    IlcSpvId srcId)
+    IlcSpvId srcId,
+    unsigned componentCount)
 {
     // Only keep the lower 5 bits of the shift value
-    IlcSpvId maskId = ilcSpvPutConstant(compiler->module, compiler->intId, SHIFT_MASK_LITERAL);
-    const IlcSpvId maskConsistuentIds[] = { maskId, maskId, maskId, maskId };
-    IlcSpvId maskCompositeId = ilcSpvPutConstantComposite(compiler->module, compiler->int4Id,
-                                                          4, maskConsistuentIds);
-    const IlcSpvId andIds[] = { srcId, maskCompositeId };
-    return ilcSpvPutAlu(compiler->module, SpvOpBitwiseAnd, compiler->int4Id, 2, andIds);
+    IlcSpvId maskId = emitConstantVector(compiler, compiler->intId, SHIFT_MASK_LITERAL,
+                                         componentCount);
+    const IlcSpvId andIds[] = { srcId, maskId };
+    return ilcSpvPutAlu(compiler->module, SpvOpBitwiseAnd,
+                        emitVectorType(compiler, compiler->intId, componentCount), 2, andIds);
 }
 
 static IlcSpvId emitVectorTrim(
@@ -212,16 +355,7 @@ static IlcSpvId emitVectorTrim(
 {
     assert(1 <= (offset + count) && (offset + count) <= 4);
 
-    IlcSpvId baseTypeId = 0;
-    if (typeId == compiler->float4Id) {
-        baseTypeId = compiler->floatId;
-    } else if (typeId == compiler->uint4Id) {
-        baseTypeId = compiler->uintId;
-    } else if (typeId == compiler->int4Id) {
-        baseTypeId = compiler->intId;
-    } else {
-        assert(false);
-    }
+    IlcSpvId baseTypeId = getComponentTypeId(compiler, typeId);
 
     const IlcSpvWord compIndex[] = {
         COMP_INDEX_X + offset, COMP_INDEX_Y + offset,
@@ -309,13 +443,40 @@ static const IlcRegister* addRegister(
     const IlcRegister* reg,
     const char* identifier)
 {
-    char name[32];
-    snprintf(name, sizeof(name), "%s%u", identifier, reg->ilNum);
-    ilcSpvPutName(compiler->module, reg->id, name);
+    if (compiler->hasDebugInfo && reg->id != 0 && reg->ilType != IL_REGTYPE_LITERAL) {
+        // Literals are constants that may be shared between registers
+        char name[32];
+        snprintf(name, sizeof(name), "%s%u", identifier, reg->ilNum);
+        ilcSpvPutName(compiler->module, reg->id, name);
+    }
+
+    assert(reg->ilType < IL_REGTYPE_LAST);
+    IlcRegisterMap* regMap = &compiler->regMaps[reg->ilType];
+
+    if (reg->ilNum >= regMap->count) {
+        unsigned newCount = 2 * regMap->count > reg->ilNum ? 2 * regMap->count : reg->ilNum + 1;
+        regMap->indices = realloc(regMap->indices, sizeof(unsigned) * newCount);
+        memset(&regMap->indices[regMap->count], 0, sizeof(unsigned) * (newCount - regMap->count));
+        regMap->count = newCount;
+    }
 
+    if (compiler->regCount == compiler->regCapacity) {
+        compiler->regCapacity = compiler->regCapacity == 0 ? 16 : 2 * compiler->regCapacity;
+        compiler->regs = realloc(compiler->regs, sizeof(IlcRegister) * compiler->regCapacity);
+        if (compiler->isSsaEnabled) {
+            compiler->ssaValues = realloc(compiler->ssaValues,
+                                          sizeof(IlcSpvId) * compiler->regCapacity);
+        }
+    }
+
+    compiler->regs[compiler->regCount] = *reg;
+    if (compiler->isSsaEnabled) {
+        compiler->ssaValues[compiler->regCount] = 0;
+    }
     compiler->regCount++;
-    compiler->regs = realloc(compiler->regs, sizeof(IlcRegister) * compiler->regCount);
-    compiler->regs[compiler->regCount - 1] = *reg;
+    if (regMap->indices[reg->ilNum] == 0) {
+        regMap->indices[reg->ilNum] = compiler->regCount;
+    }
 
     return &compiler->regs[compiler->regCount - 1];
 }
@@ -325,15 +486,17 @@ static const IlcRegister* findRegister(
     uint32_t type,
     uint32_t num)
 {
-    for (int i = 0; i < compiler->regCount; i++) {
-        const IlcRegister* reg = &compiler->regs[i];
+    if (type >= IL_REGTYPE_LAST) {
+        return NULL;
+    }
 
-        if (reg->ilType == type && reg->ilNum == num) {
-            return reg;
-        }
+    const IlcRegisterMap* regMap = &compiler->regMaps[type];
+
+    if (num >= regMap->count || regMap->indices[num] == 0) {
+        return NULL;
     }
 
-    return NULL;
+    return &compiler->regs[regMap->indices[num] - 1];
 }
 
 static const IlcRegister* findOrCreateRegister(
@@ -346,7 +509,9 @@ static const IlcRegister* findOrCreateRegister(
     if (reg == NULL && type == IL_REGTYPE_TEMP) {
         // Create temporary register
         IlcSpvId tempTypeId = compiler->float4Id;
-        IlcSpvId tempId = emitVariable(compiler, tempTypeId, SpvStorageClassPrivate);
+        // SSA temporaries are plain values, they don't need a variable
+        IlcSpvId tempId = compiler->isSsaEnabled ? 0 :
+                          emitVariable(compiler, tempTypeId, SpvStorageClassPrivate);
 
         const IlcRegister tempReg = {
             .id = tempId,
@@ -357,6 +522,8 @@ static const IlcRegister* findOrCreateRegister(
             .ilNum = num,
             .ilImportUsage = 0,
             .ilInterpMode = 0,
+            .constantValues = NULL,
+            .constantCount = 0,
         };
 
         reg = addRegister(compiler, &tempReg, "r");
@@ -390,9 +557,11 @@ static void addResource(
         assert(false);
     }
 
-    char name[32];
-    snprintf(name, sizeof(name), "resource%u.%u", resource->resType, resource->ilId);
-    ilcSpvPutName(compiler->module, resource->id, name);
+    if (compiler->hasDebugInfo) {
+        char name[32];
+        snprintf(name, sizeof(name), "resource%u.%u", resource->resType, resource->ilId);
+        ilcSpvPutName(compiler->module, resource->id, name);
+    }
 
     compiler->resourceCount++;
     compiler->resources = realloc(compiler->resources,
@@ -424,9 +593,11 @@ static const IlcSampler* addSampler(
         assert(false);
     }
 
-    char name[32];
-    snprintf(name, sizeof(name), "sampler%u", sampler->ilId);
-    ilcSpvPutName(compiler->module, sampler->id, name);
+    if (compiler->hasDebugInfo) {
+        char name[32];
+        snprintf(name, sizeof(name), "sampler%u", sampler->ilId);
+        ilcSpvPutName(compiler->module, sampler->id, name);
+    }
 
     compiler->samplerCount++;
     compiler->samplers = realloc(compiler->samplers, sizeof(IlcSampler) * compiler->samplerCount);
@@ -485,12 +656,12 @@ static IlcControlFlowBlock popControlFlowBlock(
     return block;
 }
 
-static const IlcControlFlowBlock* findControlFlowBlock(
+static IlcControlFlowBlock* findControlFlowBlock(
     IlcCompiler* compiler,
     IlcControlFlowBlockType type)
 {
     for (int i = compiler->controlFlowBlockCount - 1; i >= 0; i--) {
-        const IlcControlFlowBlock* block = &compiler->controlFlowBlocks[i];
+        IlcControlFlowBlock* block = &compiler->controlFlowBlocks[i];
 
         if (block->type == type) {
             return block;
@@ -500,11 +671,396 @@ static const IlcControlFlowBlock* findControlFlowBlock(
     return NULL;
 }
 
-static IlcSpvId loadSource(
+static bool isSsaRegister(
+    const IlcCompiler* compiler,
+    const IlcRegister* reg)
+{
+    // Indexed temporaries are addressed dynamically and stay in memory
+    return compiler->isSsaEnabled && reg->ilType == IL_REGTYPE_TEMP;
+}
+
+static IlcSpvId getSsaValue(
+    IlcCompiler* compiler,
+    const IlcSpvId* values,
+    unsigned valueCount,
+    unsigned regIndex)
+{
+    if (regIndex < valueCount && values[regIndex] != 0) {
+        return values[regIndex];
+    }
+
+    // Not written yet, read as zero
+    IlcSpvId zeroId = ilcSpvPutConstant(compiler->module, compiler->floatId, ZERO_LITERAL);
+    const IlcSpvId zeroConsistuentIds[] = { zeroId, zeroId, zeroId, zeroId };
+    return ilcSpvPutConstantComposite(compiler->module, compiler->float4Id,
+                                      4, zeroConsistuentIds);
+}
+
+static IlcSsaState saveSsaState(
+    IlcCompiler* compiler)
+{
+    IlcSsaState state = {
+        .labelId = compiler->currentLabelId,
+        .valueCount = compiler->regCount,
+        .values = malloc(sizeof(IlcSpvId) * compiler->regCount),
+    };
+
+    for (unsigned i = 0; i < compiler->regCount; i++) {
+        state.values[i] = compiler->ssaValues[i];
+    }
+
+    return state;
+}
+
+static void restoreSsaState(
+    IlcCompiler* compiler,
+    const IlcSsaState* state)
+{
+    // Temporaries created since the state was saved are unwritten
+    for (unsigned i = 0; i < compiler->regCount; i++) {
+        compiler->ssaValues[i] = i < state->valueCount ? state->values[i] : 0;
+    }
+}
+
+static void addSsaState(
+    unsigned* stateCount,
+    IlcSsaState** states,
+    const IlcSsaState* state)
+{
+    (*stateCount)++;
+    *states = realloc(*states, sizeof(IlcSsaState) * *stateCount);
+    (*states)[*stateCount - 1] = *state;
+}
+
+static void freeSsaStates(
+    unsigned stateCount,
+    IlcSsaState* states)
+{
+    for (unsigned i = 0; i < stateCount; i++) {
+        free(states[i].values);
+    }
+}
+
+static IlcSpvId emitSsaPhi(
+    IlcCompiler* compiler,
+    IlcSpvId resultId,
+    unsigned regIndex,
+    unsigned stateCount,
+    const IlcSsaState* states)
+{
+    IlcSpvId* ids = malloc(sizeof(IlcSpvId) * 2 * stateCount);
+
+    for (unsigned i = 0; i < stateCount; i++) {
+        ids[2 * i + 0] = getSsaValue(compiler, states[i].values, states[i].valueCount, regIndex);
+        ids[2 * i + 1] = states[i].labelId;
+    }
+
+    IlcSpvId phiId = ilcSpvPutPhi(compiler->module, compiler->float4Id, resultId,
+                                  2 * stateCount, ids);
+    free(ids);
+    return phiId;
+}
+
+static void emitSsaMerge(
+    IlcCompiler* compiler,
+    unsigned stateCount,
+    const IlcSsaState* states)
+{
+    // Must directly follow the label of the merge block
+    if (stateCount == 0) {
+        // Unreachable block, keep current values
+        return;
+    }
+
+    for (unsigned i = 0; i < compiler->regCount; i++) {
+        if (!isSsaRegister(compiler, &compiler->regs[i])) {
+            continue;
+        }
+
+        IlcSpvId valueId = getSsaValue(compiler, states[0].values, states[0].valueCount, i);
+        bool isSameValue = true;
+
+        for (unsigned j = 1; j < stateCount; j++) {
+            if (getSsaValue(compiler, states[j].values, states[j].valueCount, i) != valueId) {
+                isSameValue = false;
+                break;
+            }
+        }
+
+        compiler->ssaValues[i] = isSameValue ? valueId :
+                                 emitSsaPhi(compiler, 0, i, stateCount, states);
+    }
+}
+
+static IlcSpvId emitFoldedConstant(
     IlcCompiler* compiler,
+    const IlcRegister* reg,
     const Source* src,
     uint8_t componentMask,
-    IlcSpvId typeId)
+    IlcSpvId typeId,
+    bool isPacked)
+{
+    bool hasNegate = src->negate[0] || src->negate[1] || src->negate[2] || src->negate[3];
+
+    if (src->invert || src->bias || src->x2 || src->sign || src->divComp != IL_DIVCOMP_NONE ||
+        src->clamp || src->srcCount > 0 ||
+        (hasNegate && typeId != compiler->float4Id && typeId != compiler->int4Id)) {
+        // Let the generic path handle (or report) it
+        return 0;
+    }
+
+    // Out of bounds constants read as zero
+    unsigned index = src->hasImmediate ? src->immediate : 0;
+    const Token* values = index < reg->constantCount ? &reg->constantValues[4 * index] : NULL;
+    IlcSpvId componentTypeId = getComponentTypeId(compiler, typeId);
+    IlcSpvId consistuentIds[4];
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < 4; i++) {
+        if (isPacked && !(componentMask & (1 << i))) {
+            continue;
+        }
+
+        uint8_t swizzle = (componentMask & (1 << i)) ? src->swizzle[i] : IL_COMPSEL_0;
+        IlcSpvWord value = 0;
+        if (swizzle <= IL_COMPSEL_W_A) {
+            value = values != NULL ? values[swizzle] : ZERO_LITERAL;
+        } else {
+            value = swizzle == IL_COMPSEL_0 ? ZERO_LITERAL : ONE_LITERAL;
+        }
+
+        if (src->abs) {
+            value &= ~SIGN_MASK_LITERAL;
+        }
+        if (src->negate[i]) {
+            value = typeId == compiler->float4Id ? value ^ SIGN_MASK_LITERAL : -value;
+        }
+
+        consistuentIds[count] = ilcSpvPutConstant(compiler->module, componentTypeId, value);
+        count++;
+    }
+
+    if (count == 1) {
+        return consistuentIds[0];
+    }
+
+    return ilcSpvPutConstantComposite(compiler->module,
+                                      emitVectorType(compiler, componentTypeId, count),
+                                      count, consistuentIds);
+}
+
+static const IlcRegister* emitImplicitInput(
+    IlcCompiler* compiler,
+    uint32_t ilType)
+{
+    SpvBuiltIn spvBuiltIn;
+    const char* name;
+
+    // Implicit inputs are declared on first use to keep the interface minimal
+    if (compiler->kernel->shaderType != IL_SHADER_COMPUTE) {
+        return NULL;
+    }
+
+    switch (ilType) {
+    case IL_REGTYPE_THREAD_ID_IN_GROUP:
+        spvBuiltIn = SpvBuiltInLocalInvocationId;
+        name = "vTidInGrp";
+        break;
+    case IL_REGTYPE_ABSOLUTE_THREAD_ID:
+        spvBuiltIn = SpvBuiltInGlobalInvocationId;
+        name = "vAbsTid";
+        break;
+    case IL_REGTYPE_THREAD_GROUP_ID:
+        spvBuiltIn = SpvBuiltInWorkgroupId;
+        name = "vThreadGrpId";
+        break;
+    default:
+        return NULL;
+    }
+
+    IlcSpvId componentTypeId = compiler->uintId;
+    IlcSpvId inputTypeId = ilcSpvPutVectorType(compiler->module, componentTypeId, 3);
+    IlcSpvId inputId = emitVariable(compiler, inputTypeId, SpvStorageClassInput);
+
+    IlcSpvWord builtInType = spvBuiltIn;
+    ilcSpvPutDecoration(compiler->module, inputId, SpvDecorationBuiltIn, 1, &builtInType);
+
+    const IlcRegister reg = {
+        .id = inputId,
+        .typeId = inputTypeId,
+        .componentTypeId = componentTypeId,
+        .componentCount = 3,
+        .ilType = ilType,
+        .ilNum = 0,
+        .ilImportUsage = 0,
+        .ilInterpMode = 0,
+        .constantValues = NULL,
+        .constantCount = 0,
+    };
+
+    return addRegister(compiler, &reg, name);
+}
+
+static IlcSpvId findSpecConstant(
+    const IlcCompiler* compiler,
+    IlcSpvWord specId)
+{
+    for (unsigned i = 0; i < compiler->specConstantCount; i++) {
+        if (compiler->specConstants[i].specId == specId) {
+            return compiler->specConstants[i].id;
+        }
+    }
+
+    return 0;
+}
+
+static void addSpecConstant(
+    IlcCompiler* compiler,
+    IlcSpvWord specId,
+    IlcSpvId id)
+{
+    compiler->specConstantCount++;
+    compiler->specConstants = realloc(compiler->specConstants,
+                                      compiler->specConstantCount * sizeof(IlcSpecConstant));
+    compiler->specConstants[compiler->specConstantCount - 1] = (IlcSpecConstant) {
+        .specId = specId,
+        .id = id,
+    };
+}
+
+static IlcSpvId emitLinkConstant(
+    IlcCompiler* compiler,
+    const IlcRegister* reg,
+    unsigned index,
+    IlcSpvId loadedId)
+{
+    if (index >= MAX_CB_SIZE) {
+        return loadedId;
+    }
+
+    IlcSpvWord flagSpecId = ILC_LINK_CONST_FLAG_SPEC_ID(reg->ilNum);
+    IlcSpvId flagId = findSpecConstant(compiler, flagSpecId);
+    if (flagId == 0) {
+        flagId = ilcSpvPutSpecConstantFalse(compiler->module, compiler->boolId);
+        ilcSpvPutDecoration(compiler->module, flagId, SpvDecorationSpecId, 1, &flagSpecId);
+        addSpecConstant(compiler, flagSpecId, flagId);
+    }
+
+    IlcSpvWord specId = ILC_LINK_CONST_SPEC_ID(reg->ilNum, 4 * index);
+    IlcSpvId constantId = findSpecConstant(compiler, specId);
+    if (constantId == 0) {
+        IlcSpvId consistuentIds[4];
+
+        for (unsigned i = 0; i < 4; i++) {
+            IlcSpvWord componentSpecId = specId + i;
+
+            consistuentIds[i] = ilcSpvPutSpecConstant(compiler->module, compiler->floatId,
+                                                      ZERO_LITERAL);
+            ilcSpvPutDecoration(compiler->module, consistuentIds[i], SpvDecorationSpecId,
+                                1, &componentSpecId);
+        }
+
+        constantId = ilcSpvPutSpecConstantComposite(compiler->module, compiler->float4Id,
+                                                    4, consistuentIds);
+        addSpecConstant(compiler, specId, constantId);
+    }
+
+    // Resolved when the pipeline is created, the load is dead code for link-time buffers
+    return ilcSpvPutSelect(compiler->module, compiler->float4Id, flagId, constantId, loadedId);
+}
+
+static bool isSameSource(
+    const IlcCachedSource* cachedSource,
+    const Source* src,
+    uint8_t componentMask,
+    IlcSpvId typeId,
+    bool isPacked)
+{
+    return cachedSource->componentMask == componentMask && cachedSource->typeId == typeId &&
+           cachedSource->isPacked == isPacked && cachedSource->abs == src->abs &&
+           cachedSource->hasImmediate == src->hasImmediate &&
+           (!src->hasImmediate || cachedSource->immediate == src->immediate) &&
+           memcmp(cachedSource->swizzle, src->swizzle, sizeof(cachedSource->swizzle)) == 0 &&
+           memcmp(cachedSource->negate, src->negate, sizeof(cachedSource->negate)) == 0;
+}
+
+static IlcSpvId findCachedSource(
+    const IlcCompiler* compiler,
+    unsigned regIndex,
+    const Source* src,
+    uint8_t componentMask,
+    IlcSpvId typeId,
+    bool isPacked)
+{
+    for (unsigned i = 0; i < compiler->cachedSourceCount; i++) {
+        const IlcCachedSource* cachedSource = &compiler->cachedSources[i];
+
+        if (cachedSource->regIndex == regIndex &&
+            isSameSource(cachedSource, src, componentMask, typeId, isPacked)) {
+            return cachedSource->id;
+        }
+    }
+
+    return 0;
+}
+
+static void addCachedSource(
+    IlcCompiler* compiler,
+    unsigned regIndex,
+    const Source* src,
+    uint8_t componentMask,
+    IlcSpvId typeId,
+    bool isPacked,
+    IlcSpvId id)
+{
+    if (compiler->cachedSourceCount == MAX_CACHED_SOURCES) {
+        // Evict the oldest entry
+        compiler->cachedSourceCount--;
+        memmove(&compiler->cachedSources[0], &compiler->cachedSources[1],
+                sizeof(IlcCachedSource) * compiler->cachedSourceCount);
+    }
+
+    IlcCachedSource* cachedSource = &compiler->cachedSources[compiler->cachedSourceCount];
+    *cachedSource = (IlcCachedSource) {
+        .regIndex = regIndex,
+        .immediate = src->immediate,
+        .swizzle = { 0 }, // Initialized below
+        .negate = { false }, // Initialized below
+        .abs = src->abs,
+        .hasImmediate = src->hasImmediate,
+        .componentMask = componentMask,
+        .isPacked = isPacked,
+        .typeId = typeId,
+        .id = id,
+    };
+
+    memcpy(cachedSource->swizzle, src->swizzle, sizeof(cachedSource->swizzle));
+    memcpy(cachedSource->negate, src->negate, sizeof(cachedSource->negate));
+    compiler->cachedSourceCount++;
+}
+
+static void invalidateCachedSources(
+    IlcCompiler* compiler,
+    unsigned regIndex)
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < compiler->cachedSourceCount; i++) {
+        if (compiler->cachedSources[i].regIndex != regIndex) {
+            compiler->cachedSources[count] = compiler->cachedSources[i];
+            count++;
+        }
+    }
+
+    compiler->cachedSourceCount = count;
+}
+
+static IlcSpvId loadSourceComponents(
+    IlcCompiler* compiler,
+    const Source* src,
+    uint8_t componentMask,
+    IlcSpvId typeId,
+    bool isPacked)
 {
     const IlcRegister* reg;
 
@@ -519,13 +1075,39 @@ static IlcSpvId loadSource(
         reg = findRegister(compiler, src->registerType, src->registerNum);
     }
 
+    if (reg == NULL && src->registerNum == 0) {
+        reg = emitImplicitInput(compiler, src->registerType);
+    }
+
     if (reg == NULL) {
         LOGE("source register %d %d not found\n", src->registerType, src->registerNum);
         return 0;
     }
 
+    // Reuse values loaded earlier in the block, relative addressing depends on other registers
+    unsigned regIndex = reg - compiler->regs;
+    bool isCacheable = src->srcCount == 0;
+    if (isCacheable) {
+        IlcSpvId cachedId = findCachedSource(compiler, regIndex, src, componentMask, typeId,
+                                             isPacked);
+        if (cachedId != 0) {
+            return cachedId;
+        }
+    }
+
+    if (reg->constantValues != NULL) {
+        // Apply the swizzle and modifiers at compile time
+        IlcSpvId constantId = emitFoldedConstant(compiler, reg, src, componentMask, typeId,
+                                                 isPacked);
+        if (constantId != 0) {
+            return constantId;
+        }
+    }
+
     IlcSpvId ptrId = 0;
-    if (src->registerType != IL_REGTYPE_ITEMP) {
+    if (src->registerType != IL_REGTYPE_ITEMP &&
+        src->registerType != IL_REGTYPE_CONST_BUFF &&
+        src->registerType != IL_REGTYPE_IMMED_CONST_BUFF) {
         if (src->hasImmediate) {
             LOGW("unhandled immediate\n");
         }
@@ -534,48 +1116,87 @@ static IlcSpvId loadSource(
         }
         ptrId = reg->id;
     } else {
-        IlcSpvId ptrTypeId = ilcSpvPutPointerType(compiler->module, SpvStorageClassPrivate,
+        // Constant buffer arrays are wrapped in a block
+        bool isBlock = src->registerType == IL_REGTYPE_CONST_BUFF;
+        IlcSpvId ptrTypeId = ilcSpvPutPointerType(compiler->module,
+                                                  isBlock ? SpvStorageClassUniform
+                                                          : SpvStorageClassPrivate,
                                                   reg->typeId);
         IlcSpvId indexId = ilcSpvPutConstant(compiler->module, compiler->intId,
                                              src->hasImmediate ? src->immediate : 0);
         if (src->srcCount > 0) {
             assert(src->srcCount == 1);
-            IlcSpvId rel4Id = loadSource(compiler, &src->srcs[0], COMP_MASK_XYZW,
-                                         compiler->int4Id);
+            IlcSpvId rel4Id = loadSourceComponents(compiler, &src->srcs[0], COMP_MASK_XYZW,
+                                                   compiler->int4Id, false);
             IlcSpvId relId = emitVectorTrim(compiler, rel4Id, compiler->int4Id, 0, 1);
             const IlcSpvId addIds[] = { indexId, relId };
             indexId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId, 2, addIds);
         }
-        ptrId = ilcSpvPutAccessChain(compiler->module, ptrTypeId, reg->id, 1, &indexId);
+        const IlcSpvId indexIds[] = {
+            ilcSpvPutConstant(compiler->module, compiler->intId, 0), indexId,
+        };
+        ptrId = ilcSpvPutAccessChain(compiler->module, ptrTypeId, reg->id,
+                                     isBlock ? 2 : 1, isBlock ? indexIds : &indexIds[1]);
     }
 
-    IlcSpvId varId = ilcSpvPutLoad(compiler->module, reg->typeId, ptrId);
-    IlcSpvId vec4TypeId = ilcSpvPutVectorType(compiler->module, reg->componentTypeId, 4);
+    IlcSpvId varId = 0;
+    if (isSsaRegister(compiler, reg)) {
+        varId = getSsaValue(compiler, compiler->ssaValues, compiler->regCount,
+                            reg - compiler->regs);
+    } else if (reg->ilType == IL_REGTYPE_LITERAL) {
+        varId = reg->id;
+    } else {
+        varId = ilcSpvPutLoad(compiler->module, reg->typeId, ptrId);
+
+        if (compiler->isLinkConstSpecEnabled && reg->ilType == IL_REGTYPE_CONST_BUFF &&
+            src->srcCount == 0) {
+            // Statically indexed constants may be provided at link time, link-time buffers
+            // are also bound as uniform buffers so the select is only an optimization
+            varId = emitLinkConstant(compiler, reg, src->hasImmediate ? src->immediate : 0,
+                                     varId);
+        }
+    }
 
     if (reg->componentCount < 4) {
         varId = emitVectorGrow(compiler, varId, reg->componentTypeId, reg->componentCount);
     }
 
-    const uint8_t swizzle[] = {
-        componentMask & COMP_MASK_X ? src->swizzle[0] : IL_COMPSEL_0,
-        componentMask & COMP_MASK_Y ? src->swizzle[1] : IL_COMPSEL_0,
-        componentMask & COMP_MASK_Z ? src->swizzle[2] : IL_COMPSEL_0,
-        componentMask & COMP_MASK_W ? src->swizzle[3] : IL_COMPSEL_0,
-    };
+    // Packed sources only keep the selected components, others are zeroed
+    unsigned count = 0;
+    IlcSpvWord swizzle[4];
+    bool negate[4];
+    for (unsigned i = 0; i < 4; i++) {
+        if (!isPacked || (componentMask & (1 << i))) {
+            swizzle[count] = (componentMask & (1 << i)) ? src->swizzle[i] : IL_COMPSEL_0;
+            negate[count] = src->negate[i];
+            count++;
+        }
+    }
+
+    IlcSpvId vecTypeId = emitVectorType(compiler, reg->componentTypeId, count);
+    IlcSpvId resTypeId = count == 4 ? typeId :
+                         emitVectorType(compiler, getComponentTypeId(compiler, typeId), count);
 
-    if (swizzle[0] != IL_COMPSEL_X_R || swizzle[1] != IL_COMPSEL_Y_G ||
-        swizzle[2] != IL_COMPSEL_Z_B || swizzle[3] != IL_COMPSEL_W_A) {
+    if (count == 1) {
+        if (swizzle[0] <= IL_COMPSEL_W_A) {
+            varId = ilcSpvPutCompositeExtract(compiler->module, vecTypeId, varId, 1, swizzle);
+        } else {
+            varId = ilcSpvPutConstant(compiler->module, vecTypeId,
+                                      swizzle[0] == IL_COMPSEL_0 ? ZERO_LITERAL : ONE_LITERAL);
+        }
+    } else if (count < 4 ||
+               swizzle[0] != IL_COMPSEL_X_R || swizzle[1] != IL_COMPSEL_Y_G ||
+               swizzle[2] != IL_COMPSEL_Z_B || swizzle[3] != IL_COMPSEL_W_A) {
         // Select components from {x, y, z, w, 0.f, 1.f}
         IlcSpvId zeroOneId = emitZeroOneVector(compiler, reg->componentTypeId);
 
-        const IlcSpvWord components[] = { swizzle[0], swizzle[1], swizzle[2], swizzle[3] };
-        varId = ilcSpvPutVectorShuffle(compiler->module, vec4TypeId, varId, zeroOneId,
-                                       4, components);
+        varId = ilcSpvPutVectorShuffle(compiler->module, vecTypeId, varId, zeroOneId,
+                                       count, swizzle);
     }
 
-    if (typeId != vec4TypeId) {
+    if (resTypeId != vecTypeId) {
         // Need to cast to the expected type
-        varId = ilcSpvPutBitcast(compiler->module, typeId, varId);
+        varId = ilcSpvPutBitcast(compiler->module, resTypeId, varId);
     }
 
     // All following operations but `neg` are float only (AMDIL spec, table 2.10)
@@ -601,32 +1222,39 @@ static IlcSpvId loadSource(
     }
 
     if (src->abs) {
-        varId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450FAbs, compiler->float4Id, 1, &varId);
+        varId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450FAbs,
+                                emitVectorType(compiler, compiler->floatId, count), 1, &varId);
+    }
+
+    bool hasNegate = false;
+    bool isFullNegate = true;
+    for (unsigned i = 0; i < count; i++) {
+        hasNegate = hasNegate || negate[i];
+        isFullNegate = isFullNegate && negate[i];
     }
 
-    if (src->negate[0] || src->negate[1] || src->negate[2] || src->negate[3]) {
+    if (hasNegate) {
         IlcSpvId negId = 0;
 
         if (typeId == compiler->float4Id) {
-            negId = ilcSpvPutAlu(compiler->module, SpvOpFNegate, compiler->float4Id, 1, &varId);
+            negId = ilcSpvPutAlu(compiler->module, SpvOpFNegate, resTypeId, 1, &varId);
         } else if (typeId == compiler->int4Id) {
-            negId = ilcSpvPutAlu(compiler->module, SpvOpSNegate, compiler->int4Id, 1, &varId);
+            negId = ilcSpvPutAlu(compiler->module, SpvOpSNegate, resTypeId, 1, &varId);
         } else {
             assert(false);
         }
 
-        if (src->negate[0] && src->negate[1] && src->negate[2] && src->negate[3]) {
+        if (isFullNegate) {
             varId = negId;
         } else {
             // Select components from {-x, -y, -z, -w, x, y, z, w}
-            const IlcSpvWord components[] = {
-                src->negate[0] ? 0 : 4,
-                src->negate[1] ? 1 : 5,
-                src->negate[2] ? 2 : 6,
-                src->negate[3] ? 3 : 7,
-            };
+            IlcSpvWord components[4];
+            for (unsigned i = 0; i < count; i++) {
+                components[i] = negate[i] ? i : count + i;
+            }
 
-            varId = ilcSpvPutVectorShuffle(compiler->module, typeId, negId, varId, 4, components);
+            varId = ilcSpvPutVectorShuffle(compiler->module, resTypeId, negId, varId,
+                                           count, components);
         }
     }
 
@@ -634,14 +1262,49 @@ static IlcSpvId loadSource(
         LOGW("unhandled clamp flag\n");
     }
 
+    if (isCacheable) {
+        addCachedSource(compiler, regIndex, src, componentMask, typeId, isPacked, varId);
+    }
+
     return varId;
 }
 
+static IlcSpvId loadSource(
+    IlcCompiler* compiler,
+    const Source* src,
+    uint8_t componentMask,
+    IlcSpvId typeId)
+{
+    // Returns a vec4, components outside of the mask are zeroed
+    return loadSourceComponents(compiler, src, componentMask, typeId, false);
+}
+
+static IlcSpvId loadPackedSource(
+    IlcCompiler* compiler,
+    const Source* src,
+    uint8_t componentMask,
+    IlcSpvId typeId)
+{
+    // Returns the masked components only, as a scalar or a narrower vector
+    return loadSourceComponents(compiler, src, componentMask, typeId, true);
+}
+
+static uint8_t getDestinationMask(
+    const Destination* dst)
+{
+    // Components to be computed, 0/1 components are forced when storing
+    return (dst->component[0] == IL_MODCOMP_WRITE ? COMP_MASK_X : 0) |
+           (dst->component[1] == IL_MODCOMP_WRITE ? COMP_MASK_Y : 0) |
+           (dst->component[2] == IL_MODCOMP_WRITE ? COMP_MASK_Z : 0) |
+           (dst->component[3] == IL_MODCOMP_WRITE ? COMP_MASK_W : 0);
+}
+
 static void storeDestination(
     IlcCompiler* compiler,
     const Destination* dst,
     IlcSpvId varId,
-    IlcSpvId typeId)
+    IlcSpvId typeId,
+    uint8_t componentMask) // Components held by varId, packed
 {
     const IlcRegister* reg = findOrCreateRegister(compiler, dst->registerType, dst->registerNum);
 
@@ -650,9 +1313,15 @@ static void storeDestination(
         return;
     }
 
-    if (typeId != reg->typeId) {
+    invalidateCachedSources(compiler, reg - compiler->regs);
+
+    unsigned count = getComponentCount(componentMask);
+    IlcSpvId packedTypeId = count == 4 ? reg->typeId :
+                            emitVectorType(compiler, reg->componentTypeId, count);
+
+    if (typeId != packedTypeId) {
         // Need to cast to the expected type
-        varId = ilcSpvPutBitcast(compiler->module, reg->typeId, varId);
+        varId = ilcSpvPutBitcast(compiler->module, packedTypeId, varId);
     }
 
     IlcSpvId ptrId = 0;
@@ -681,32 +1350,57 @@ static void storeDestination(
 
     if (dst->clamp) {
         // Clamp to [0.f, 1.f]
-        IlcSpvId zeroId = ilcSpvPutConstant(compiler->module, compiler->floatId, ZERO_LITERAL);
-        IlcSpvId oneId = ilcSpvPutConstant(compiler->module, compiler->floatId, ONE_LITERAL);
-        const IlcSpvId zeroConsistuentIds[] = { zeroId, zeroId, zeroId, zeroId };
-        const IlcSpvId oneConsistuentIds[] = { oneId, oneId, oneId, oneId };
-        IlcSpvId zeroCompositeId = ilcSpvPutConstantComposite(compiler->module, reg->typeId,
-                                                              4, zeroConsistuentIds);
-        IlcSpvId oneCompositeId = ilcSpvPutConstantComposite(compiler->module, reg->typeId,
-                                                             4, oneConsistuentIds);
+        IlcSpvId zeroId = emitConstantVector(compiler, compiler->floatId, ZERO_LITERAL, count);
+        IlcSpvId oneId = emitConstantVector(compiler, compiler->floatId, ONE_LITERAL, count);
 
-        const IlcSpvId paramIds[] = { varId, zeroCompositeId, oneCompositeId };
-        varId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450FClamp, reg->typeId, 3, paramIds);
+        const IlcSpvId paramIds[] = { varId, zeroId, oneId };
+        varId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450FClamp, packedTypeId, 3, paramIds);
     }
 
-    if (dst->component[0] == IL_MODCOMP_NOWRITE || dst->component[1] == IL_MODCOMP_NOWRITE ||
-        dst->component[2] == IL_MODCOMP_NOWRITE || dst->component[3] == IL_MODCOMP_NOWRITE) {
-        // Select components from {dst.x, dst.y, dst.z, dst.w, x, y, z, w}
-        IlcSpvId origId = ilcSpvPutLoad(compiler->module, reg->typeId, ptrId);
+    bool hasUnwrittenComponent =
+        dst->component[0] == IL_MODCOMP_NOWRITE || dst->component[1] == IL_MODCOMP_NOWRITE ||
+        dst->component[2] == IL_MODCOMP_NOWRITE || dst->component[3] == IL_MODCOMP_NOWRITE;
 
-        const IlcSpvWord components[] = {
-            dst->component[0] == IL_MODCOMP_NOWRITE ? 0 : 4,
-            dst->component[1] == IL_MODCOMP_NOWRITE ? 1 : 5,
-            dst->component[2] == IL_MODCOMP_NOWRITE ? 2 : 6,
-            dst->component[3] == IL_MODCOMP_NOWRITE ? 3 : 7,
-        };
-        varId = ilcSpvPutVectorShuffle(compiler->module, reg->typeId, origId, varId,
-                                       4, components);
+    if (hasUnwrittenComponent || count < 4) {
+        IlcSpvId origId = 0;
+        if (!hasUnwrittenComponent) {
+            // Remaining components are forced to 0 or 1 below
+            origId = emitConstantVector(compiler, reg->componentTypeId, ZERO_LITERAL, 4);
+        } else if (isSsaRegister(compiler, reg)) {
+            origId = getSsaValue(compiler, compiler->ssaValues, compiler->regCount,
+                                 reg - compiler->regs);
+        } else {
+            origId = ilcSpvPutLoad(compiler->module, reg->typeId, ptrId);
+        }
+
+        if (count == 1) {
+            IlcSpvWord index = 0;
+            while (!(componentMask & (1 << index))) {
+                index++;
+            }
+
+            if (dst->component[index] != IL_MODCOMP_NOWRITE) {
+                varId = ilcSpvPutCompositeInsert(compiler->module, reg->typeId, varId, origId,
+                                                 1, &index);
+            } else {
+                varId = origId;
+            }
+        } else {
+            // Select components from {dst.x, dst.y, dst.z, dst.w} and the packed components
+            IlcSpvWord components[4];
+            unsigned packedIndex = 0;
+            for (unsigned i = 0; i < 4; i++) {
+                if (componentMask & (1 << i)) {
+                    components[i] = dst->component[i] != IL_MODCOMP_NOWRITE ? 4 + packedIndex : i;
+                    packedIndex++;
+                } else {
+                    components[i] = i;
+                }
+            }
+
+            varId = ilcSpvPutVectorShuffle(compiler->module, reg->typeId, origId, varId,
+                                           4, components);
+        }
     }
 
     if ((dst->component[0] == IL_MODCOMP_0 || dst->component[0] == IL_MODCOMP_1) ||
@@ -726,7 +1420,11 @@ static void storeDestination(
                                        4, components);
     }
 
-    ilcSpvPutStore(compiler->module, ptrId, varId);
+    if (isSsaRegister(compiler, reg)) {
+        compiler->ssaValues[reg - compiler->regs] = varId;
+    } else {
+        ilcSpvPutStore(compiler->module, ptrId, varId);
+    }
 }
 
 static void emitGlobalFlags(
@@ -763,7 +1461,8 @@ static void emitIndexedTempArray(
     // Create temporary array register
     unsigned arraySize = src->immediate;
     IlcSpvId lengthId = ilcSpvPutConstant(compiler->module, compiler->uintId, arraySize);
-    IlcSpvId arrayTypeId = ilcSpvPutArrayType(compiler->module, compiler->float4Id, lengthId);
+    IlcSpvId arrayTypeId = ilcSpvPutArrayType(compiler->module, compiler->float4Id, lengthId,
+                                              false);
     IlcSpvId arrayId = emitVariable(compiler, arrayTypeId, SpvStorageClassPrivate);
 
     const IlcRegister tempArrayReg = {
@@ -775,11 +1474,98 @@ static void emitIndexedTempArray(
         .ilNum = src->registerNum,
         .ilImportUsage = 0,
         .ilInterpMode = 0,
+        .constantValues = NULL,
+        .constantCount = 0,
     };
 
     addRegister(compiler, &tempArrayReg, "x");
 }
 
+static void emitConstBuffer(
+    IlcCompiler* compiler,
+    const Instruction* instr)
+{
+    bool isImmediate = GET_BIT(instr->control, 15);
+
+    if (isImmediate) {
+        // Contents are known at compile time, statically indexed reads are folded
+        unsigned size = instr->extraCount / 4;
+        IlcSpvId lengthId = ilcSpvPutConstant(compiler->module, compiler->uintId, size);
+        IlcSpvId arrayTypeId = ilcSpvPutArrayType(compiler->module, compiler->float4Id, lengthId,
+                                                  false);
+        IlcSpvId arrayId = emitVariable(compiler, arrayTypeId, SpvStorageClassPrivate);
+        IlcSpvId* consistuentIds = malloc(size * sizeof(IlcSpvId));
+
+        for (unsigned i = 0; i < size; i++) {
+            const IlcSpvId vecIds[] = {
+                ilcSpvPutConstant(compiler->module, compiler->floatId, instr->extras[4 * i + 0]),
+                ilcSpvPutConstant(compiler->module, compiler->floatId, instr->extras[4 * i + 1]),
+                ilcSpvPutConstant(compiler->module, compiler->floatId, instr->extras[4 * i + 2]),
+                ilcSpvPutConstant(compiler->module, compiler->floatId, instr->extras[4 * i + 3]),
+            };
+            consistuentIds[i] = ilcSpvPutConstantComposite(compiler->module, compiler->float4Id,
+                                                           4, vecIds);
+        }
+
+        IlcSpvId compositeId = ilcSpvPutConstantComposite(compiler->module, arrayTypeId,
+                                                          size, consistuentIds);
+        ilcSpvPutStore(compiler->module, arrayId, compositeId);
+        free(consistuentIds);
+
+        const IlcRegister reg = {
+            .id = arrayId,
+            .typeId = compiler->float4Id,
+            .componentTypeId = compiler->floatId,
+            .componentCount = 4,
+            .ilType = IL_REGTYPE_IMMED_CONST_BUFF,
+            .ilNum = 0,
+            .ilImportUsage = 0,
+            .ilInterpMode = 0,
+            .constantValues = instr->extras,
+            .constantCount = size,
+        };
+
+        addRegister(compiler, &reg, "icb");
+        return;
+    }
+
+    const Source* src = &instr->srcs[0];
+
+    assert(src->registerType == IL_REGTYPE_CONST_BUFF);
+
+    unsigned size = src->hasImmediate ? src->immediate : MAX_CB_SIZE;
+    IlcSpvId lengthId = ilcSpvPutConstant(compiler->module, compiler->uintId, size);
+    IlcSpvId arrayId = ilcSpvPutArrayType(compiler->module, compiler->float4Id, lengthId, true);
+    IlcSpvId structId = ilcSpvPutStructType(compiler->module, 1, &arrayId);
+    IlcSpvId pointerId = ilcSpvPutPointerType(compiler->module, SpvStorageClassUniform, structId);
+    IlcSpvId bufferId = ilcSpvPutVariable(compiler->module, pointerId, SpvStorageClassUniform);
+
+    IlcSpvWord arrayStride = 4 * sizeof(float);
+    IlcSpvWord memberOffset = 0;
+    ilcSpvPutDecoration(compiler->module, arrayId, SpvDecorationArrayStride, 1, &arrayStride);
+    ilcSpvPutDecoration(compiler->module, structId, SpvDecorationBlock, 0, NULL);
+    ilcSpvPutMemberDecoration(compiler->module, structId, 0, SpvDecorationOffset, 1, &memberOffset);
+
+    // Constant buffers share the shader entity index space with resources
+    emitBinding(compiler, bufferId, ILC_BASE_RESOURCE_ID + src->registerNum,
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
+
+    const IlcRegister reg = {
+        .id = bufferId,
+        .typeId = compiler->float4Id,
+        .componentTypeId = compiler->floatId,
+        .componentCount = 4,
+        .ilType = src->registerType,
+        .ilNum = src->registerNum,
+        .ilImportUsage = 0,
+        .ilInterpMode = 0,
+        .constantValues = NULL,
+        .constantCount = 0,
+    };
+
+    addRegister(compiler, &reg, "cb");
+}
+
 static void emitLiteral(
     IlcCompiler* compiler,
     const Instruction* instr)
@@ -788,9 +1574,8 @@ static void emitLiteral(
 
     assert(src->registerType == IL_REGTYPE_LITERAL);
 
+    // Literals are never written to, keep them as constants so that uses can be folded
     IlcSpvId literalTypeId = compiler->float4Id;
-    IlcSpvId literalId = emitVariable(compiler, literalTypeId, SpvStorageClassPrivate);
-
     IlcSpvId consistuentIds[] = {
         ilcSpvPutConstant(compiler->module, compiler->floatId, instr->extras[0]),
         ilcSpvPutConstant(compiler->module, compiler->floatId, instr->extras[1]),
@@ -800,10 +1585,8 @@ static void emitLiteral(
     IlcSpvId compositeId = ilcSpvPutConstantComposite(compiler->module, literalTypeId,
                                                       4, consistuentIds);
 
-    ilcSpvPutStore(compiler->module, literalId, compositeId);
-
     const IlcRegister reg = {
-        .id = literalId,
+        .id = compositeId,
         .typeId = literalTypeId,
         .componentTypeId = compiler->floatId,
         .componentCount = 4,
@@ -811,6 +1594,8 @@ static void emitLiteral(
         .ilNum = src->registerNum,
         .ilImportUsage = 0,
         .ilInterpMode = 0,
+        .constantValues = instr->extras,
+        .constantCount = 1,
     };
 
     addRegister(compiler, &reg, "l");
@@ -867,6 +1652,8 @@ static void emitOutput(
         .ilNum = dst->registerNum,
         .ilImportUsage = importUsage,
         .ilInterpMode = 0,
+        .constantValues = NULL,
+        .constantCount = 0,
     };
 
     addRegister(compiler, &reg, "o");
@@ -974,6 +1761,8 @@ static void emitInput(
         .ilNum = dst->registerNum,
         .ilImportUsage = importUsage,
         .ilInterpMode = interpMode,
+        .constantValues = NULL,
+        .constantCount = 0,
     };
 
     addRegister(compiler, &reg, "v");
@@ -1045,6 +1834,7 @@ static void emitResource(
         .ilId = id,
         .ilType = type,
         .strideId = 0,
+        .isVectorized = false,
     };
 
     addResource(compiler, &resource);
@@ -1098,7 +1888,9 @@ static void emitTypedUav(
     IlcSpvId resourceId = ilcSpvPutVariable(compiler->module, pImageId,
                                             SpvStorageClassUniformConstant);
 
-    ilcSpvPutName(compiler->module, imageId, "typedUav");
+    if (compiler->hasDebugInfo) {
+        ilcSpvPutName(compiler->module, imageId, "typedUav");
+    }
     emitBinding(compiler, resourceId, ILC_BASE_RESOURCE_ID + id,
                 spvDim == SpvDimBuffer ?
                 VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE);
@@ -1111,6 +1903,7 @@ static void emitTypedUav(
         .ilId = id,
         .ilType = type,
         .strideId = 0,
+        .isVectorized = false,
     };
 
     addResource(compiler, &resource);
@@ -1122,22 +1915,29 @@ static void emitSrv(
 {
     bool isStructured = instr->opcode == IL_OP_DCL_STRUCT_SRV;
     uint16_t id = GET_BITS(instr->control, 0, 13);
+    unsigned stride = isStructured ? instr->extras[0] : sizeof(float);
 
-    IlcSpvId arrayId = ilcSpvPutRuntimeArrayType(compiler->module, compiler->floatId, true);
+    // Access whole vectors when structure elements are 16-byte aligned
+    bool isVectorized = (stride % (4 * sizeof(float))) == 0;
+    IlcSpvId elementTypeId = isVectorized ? compiler->float4Id : compiler->floatId;
+
+    IlcSpvId arrayId = ilcSpvPutRuntimeArrayType(compiler->module, elementTypeId, true);
     IlcSpvId structId = ilcSpvPutStructType(compiler->module, 1, &arrayId);
     IlcSpvId pointerId = ilcSpvPutPointerType(compiler->module, SpvStorageClassStorageBuffer,
                                               structId);
     IlcSpvId resourceId = ilcSpvPutVariable(compiler->module, pointerId,
                                             SpvStorageClassStorageBuffer);
 
-    IlcSpvWord arrayStride = sizeof(float);
+    IlcSpvWord arrayStride = isVectorized ? 4 * sizeof(float) : sizeof(float);
     IlcSpvWord memberOffset = 0;
     ilcSpvPutDecoration(compiler->module, arrayId, SpvDecorationArrayStride, 1, &arrayStride);
     ilcSpvPutDecoration(compiler->module, structId, SpvDecorationBlock, 0, NULL);
     ilcSpvPutMemberDecoration(compiler->module, structId, 0, SpvDecorationOffset, 1, &memberOffset);
     ilcSpvPutDecoration(compiler->module, resourceId, SpvDecorationNonWritable, 0, NULL);
 
-    ilcSpvPutName(compiler->module, arrayId, isStructured ? "structSrv" : "rawSrv");
+    if (compiler->hasDebugInfo) {
+        ilcSpvPutName(compiler->module, arrayId, isStructured ? "structSrv" : "rawSrv");
+    }
     emitBinding(compiler, resourceId, ILC_BASE_RESOURCE_ID + id, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
 
     const IlcResource resource = {
@@ -1147,8 +1947,8 @@ static void emitSrv(
         .texelTypeId = compiler->floatId,
         .ilId = id,
         .ilType = IL_USAGE_PIXTEX_UNKNOWN,
-        .strideId = ilcSpvPutConstant(compiler->module, compiler->intId,
-                                      isStructured ? instr->extras[0] : 4),
+        .strideId = ilcSpvPutConstant(compiler->module, compiler->intId, stride),
+        .isVectorized = isVectorized,
     };
 
     addResource(compiler, &resource);
@@ -1162,12 +1962,19 @@ static void emitStructuredLds(
     unsigned stride = instr->extras[0];
     unsigned length = instr->extras[1];
 
-    IlcSpvId lengthId = ilcSpvPutConstant(compiler->module, compiler->uintId, stride * length);
-    IlcSpvId arrayId = ilcSpvPutArrayType(compiler->module, compiler->uintId, lengthId);
+    // Access whole vectors when structure elements are 16-byte aligned
+    bool isVectorized = (stride % (4 * sizeof(uint32_t))) == 0;
+    IlcSpvId elementTypeId = isVectorized ? compiler->uint4Id : compiler->uintId;
+    unsigned elementCount = isVectorized ? stride * length / 4 : stride * length;
+
+    IlcSpvId lengthId = ilcSpvPutConstant(compiler->module, compiler->uintId, elementCount);
+    IlcSpvId arrayId = ilcSpvPutArrayType(compiler->module, elementTypeId, lengthId, false);
     IlcSpvId pArrayId = ilcSpvPutPointerType(compiler->module, SpvStorageClassWorkgroup, arrayId);
     IlcSpvId resourceId = ilcSpvPutVariable(compiler->module, pArrayId, SpvStorageClassWorkgroup);
 
-    ilcSpvPutName(compiler->module, arrayId, "structLds");
+    if (compiler->hasDebugInfo) {
+        ilcSpvPutName(compiler->module, arrayId, "structLds");
+    }
 
     const IlcResource resource = {
         .resType = RES_TYPE_LDS,
@@ -1177,11 +1984,23 @@ static void emitStructuredLds(
         .ilId = id,
         .ilType = IL_USAGE_PIXTEX_UNKNOWN,
         .strideId = ilcSpvPutConstant(compiler->module, compiler->intId, stride),
+        .isVectorized = isVectorized,
     };
 
     addResource(compiler, &resource);
 }
 
+static IlcSpvId emitLabel(
+    IlcCompiler* compiler,
+    IlcSpvId labelId)
+{
+    // Keep track of the current block for phi operands
+    compiler->currentLabelId = ilcSpvPutLabel(compiler->module, labelId);
+    // Values loaded in other blocks may not dominate this one
+    compiler->cachedSourceCount = 0;
+    return compiler->currentLabelId;
+}
+
 static void emitFunc(
     IlcCompiler* compiler,
     IlcSpvId id)
@@ -1189,73 +2008,87 @@ static void emitFunc(
     IlcSpvId voidTypeId = ilcSpvPutVoidType(compiler->module);
     IlcSpvId funcTypeId = ilcSpvPutFunctionType(compiler->module, voidTypeId, 0, NULL);
     ilcSpvPutFunction(compiler->module, voidTypeId, id, SpvFunctionControlMaskNone, funcTypeId);
-    ilcSpvPutLabel(compiler->module, 0);
+    emitLabel(compiler, 0);
 }
 
 static void emitFloatOp(
     IlcCompiler* compiler,
     const Instruction* instr)
 {
+    const Destination* dst = &instr->dsts[0];
     IlcSpvId srcIds[MAX_SRC_COUNT] = { 0 };
     IlcSpvId resId = 0;
     uint8_t componentMask = 0;
+    uint8_t dstMask = getDestinationMask(dst);
+
+    if (dstMask == 0 || instr->opcode == IL_OP_F_2_F16 || instr->opcode == IL_OP_F16_2_F) {
+        // Nothing to narrow or components depend on each other
+        dstMask = COMP_MASK_XYZW;
+    }
 
     switch (instr->opcode) {
+    case IL_OP_ACOS:
+    case IL_OP_ASIN:
+    case IL_OP_ATAN:
+        componentMask = COMP_MASK_W;
+        break;
     case IL_OP_DP2:
         componentMask = COMP_MASK_XY;
         break;
     case IL_OP_DP3:
         componentMask = COMP_MASK_XYZ;
         break;
-    default:
+    case IL_OP_DP4:
         componentMask = COMP_MASK_XYZW;
         break;
+    default:
+        // Only compute the written components
+        componentMask = dstMask;
+        break;
     }
 
     for (int i = 0; i < instr->srcCount; i++) {
-        srcIds[i] = loadSource(compiler, &instr->srcs[i], componentMask, compiler->float4Id);
+        srcIds[i] = loadPackedSource(compiler, &instr->srcs[i], componentMask, compiler->float4Id);
     }
 
+    unsigned count = getComponentCount(componentMask);
+    unsigned dstCount = getComponentCount(dstMask);
+    IlcSpvId floatTypeId = emitVectorType(compiler, compiler->floatId, count);
+    IlcSpvId intTypeId = emitVectorType(compiler, compiler->intId, count);
+    IlcSpvId uintTypeId = emitVectorType(compiler, compiler->uintId, count);
+
     switch (instr->opcode) {
     case IL_OP_ABS:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450FAbs, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450FAbs, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_ACOS: {
-        IlcSpvId acosId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Acos, compiler->float4Id,
+        IlcSpvId acosId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Acos, compiler->floatId,
                                           instr->srcCount, srcIds);
         // Replicate .w on all components
-        const IlcSpvWord components[] = { COMP_INDEX_W, COMP_INDEX_W, COMP_INDEX_W, COMP_INDEX_W };
-        resId = ilcSpvPutVectorShuffle(compiler->module, compiler->float4Id, acosId, acosId,
-                                       4, components);
+        resId = emitVectorSplat(compiler, acosId, compiler->floatId, dstCount);
     }   break;
     case IL_OP_ADD:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpFAdd, compiler->float4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpFAdd, floatTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_ASIN: {
-        IlcSpvId asinId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Asin, compiler->float4Id,
+        IlcSpvId asinId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Asin, compiler->floatId,
                                           instr->srcCount, srcIds);
         // Replicate .w on all components
-        const IlcSpvWord components[] = { COMP_INDEX_W, COMP_INDEX_W, COMP_INDEX_W, COMP_INDEX_W };
-        resId = ilcSpvPutVectorShuffle(compiler->module, compiler->float4Id, asinId, asinId,
-                                       4, components);
+        resId = emitVectorSplat(compiler, asinId, compiler->floatId, dstCount);
     }   break;
     case IL_OP_ATAN: {
-        IlcSpvId atanId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Atan, compiler->float4Id,
+        IlcSpvId atanId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Atan, compiler->floatId,
                                           instr->srcCount, srcIds);
         // Replicate .w on all components
-        const IlcSpvWord components[] = { COMP_INDEX_W, COMP_INDEX_W, COMP_INDEX_W, COMP_INDEX_W };
-        resId = ilcSpvPutVectorShuffle(compiler->module, compiler->float4Id, atanId, atanId,
-                                       4, components);
+        resId = emitVectorSplat(compiler, atanId, compiler->floatId, dstCount);
     }   break;
     case IL_OP_DIV:
         if (instr->control != IL_ZEROOP_INFINITY) {
             LOGW("unhandled div zero op %d\n", instr->control);
         }
         // FIXME SPIR-V has undefined division by zero
-        resId = ilcSpvPutAlu(compiler->module, SpvOpFDiv, compiler->float4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpFDiv, floatTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_DP2:
     case IL_OP_DP3:
@@ -1267,7 +2100,7 @@ static void emitFloatOp(
         IlcSpvId dotId = ilcSpvPutAlu(compiler->module, SpvOpDot, compiler->floatId,
                                       instr->srcCount, srcIds);
         // Replicate dot product on all components
-        resId = emitVectorGrow(compiler, dotId, compiler->floatId, 1);
+        resId = emitVectorSplat(compiler, dotId, compiler->floatId, dstCount);
     }   break;
     case IL_OP_DSX:
     case IL_OP_DSY: {
@@ -1275,10 +2108,10 @@ static void emitFloatOp(
         IlcSpvWord op = instr->opcode == IL_OP_DSX ? (fine ? SpvOpDPdxFine : SpvOpDPdxCoarse)
                                                    : (fine ? SpvOpDPdyFine : SpvOpDPdyCoarse);
         ilcSpvPutCapability(compiler->module, SpvCapabilityDerivativeControl);
-        resId = ilcSpvPutAlu(compiler->module, op, compiler->float4Id, instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, op, floatTypeId, instr->srcCount, srcIds);
     }   break;
     case IL_OP_FRC:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Fract, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Fract, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_MAD: {
@@ -1286,7 +2119,7 @@ static void emitFloatOp(
         if (!ieee) {
             LOGW("unhandled non-IEEE mad\n");
         }
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Fma, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Fma, floatTypeId,
                                 instr->srcCount, srcIds);
     }   break;
     case IL_OP_MAX: {
@@ -1294,7 +2127,7 @@ static void emitFloatOp(
         if (!ieee) {
             LOGW("unhandled non-IEEE max\n");
         }
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450NMax, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450NMax, floatTypeId,
                                 instr->srcCount, srcIds);
     }   break;
     case IL_OP_MIN: {
@@ -1302,7 +2135,7 @@ static void emitFloatOp(
         if (!ieee) {
             LOGW("unhandled non-IEEE min\n");
         }
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450NMin, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450NMin, floatTypeId,
                                 instr->srcCount, srcIds);
     }   break;
     case IL_OP_MOV:
@@ -1313,66 +2146,65 @@ static void emitFloatOp(
         if (!ieee) {
             LOGW("unhandled non-IEEE mul\n");
         }
-        resId = ilcSpvPutAlu(compiler->module, SpvOpFMul, compiler->float4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpFMul, floatTypeId, instr->srcCount, srcIds);
     }   break;
     case IL_OP_FTOI:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertFToS, compiler->int4Id,
+        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertFToS, intTypeId,
                              instr->srcCount, srcIds);
-        resId = ilcSpvPutBitcast(compiler->module, compiler->float4Id, resId);
+        resId = ilcSpvPutBitcast(compiler->module, floatTypeId, resId);
         break;
     case IL_OP_FTOU:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertFToU, compiler->uint4Id,
+        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertFToU, uintTypeId,
                              instr->srcCount, srcIds);
-        resId = ilcSpvPutBitcast(compiler->module, compiler->float4Id, resId);
+        resId = ilcSpvPutBitcast(compiler->module, floatTypeId, resId);
         break;
     case IL_OP_ITOF:
-        resId = ilcSpvPutBitcast(compiler->module, compiler->int4Id, srcIds[0]);
-        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertSToF, compiler->float4Id, 1, &resId);
+        resId = ilcSpvPutBitcast(compiler->module, intTypeId, srcIds[0]);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertSToF, floatTypeId, 1, &resId);
         break;
     case IL_OP_UTOF:
-        resId = ilcSpvPutBitcast(compiler->module, compiler->uint4Id, srcIds[0]);
-        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertUToF, compiler->float4Id, 1, &resId);
+        resId = ilcSpvPutBitcast(compiler->module, uintTypeId, srcIds[0]);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpConvertUToF, floatTypeId, 1, &resId);
         break;
     case IL_OP_ROUND_NEAR:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Round, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Round, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_ROUND_NEG_INF:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Floor, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Floor, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_ROUND_PLUS_INF:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Ceil, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Ceil, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_ROUND_ZERO:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Trunc, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Trunc, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_EXP_VEC:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Exp, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Exp, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_LOG_VEC:
         // FIXME handle log(0)
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Log, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Log, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_RSQ_VEC:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450InverseSqrt, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450InverseSqrt, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_SIN_VEC:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Sin, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Sin, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_COS_VEC:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Cos, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Cos, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_SQRT_VEC:
-        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Sqrt, compiler->float4Id,
+        resId = ilcSpvPutGLSLOp(compiler->module, GLSLstd450Sqrt, floatTypeId,
                                 instr->srcCount, srcIds);
         break;
     case IL_OP_F_2_F16: {
@@ -1430,7 +2262,8 @@ static void emitFloatOp(
         break;
     }
 
-    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id);
+    storeDestination(compiler, dst, resId, emitVectorType(compiler, compiler->floatId, dstCount),
+                     dstMask);
 }
 
 static void emitFloatComparisonOp(
@@ -1475,64 +2308,71 @@ static void emitFloatComparisonOp(
     IlcSpvId resId = ilcSpvPutSelect(compiler->module, compiler->float4Id, condId,
                                      trueCompositeId, falseCompositeId);
 
-    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id);
+    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id, COMP_MASK_XYZW);
 }
 
 static void emitIntegerOp(
     IlcCompiler* compiler,
     const Instruction* instr)
 {
+    const Destination* dst = &instr->dsts[0];
     IlcSpvId srcIds[MAX_SRC_COUNT] = { 0 };
-    IlcSpvId typeId = 0;
+    IlcSpvId vec4TypeId = 0;
+    IlcSpvId componentTypeId = 0;
     IlcSpvId resId = 0;
+    uint8_t dstMask = getDestinationMask(dst);
+
+    if (dstMask == 0) {
+        dstMask = COMP_MASK_XYZW;
+    }
 
     if (instr->opcode == IL_OP_U_DIV ||
         instr->opcode == IL_OP_U_MOD) {
-        typeId = compiler->uint4Id;
+        vec4TypeId = compiler->uint4Id;
+        componentTypeId = compiler->uintId;
     } else {
-        typeId = compiler->int4Id;
+        vec4TypeId = compiler->int4Id;
+        componentTypeId = compiler->intId;
     }
 
+    // Only compute the written components
     for (int i = 0; i < instr->srcCount; i++) {
-        srcIds[i] = loadSource(compiler, &instr->srcs[i], COMP_MASK_XYZW, typeId);
+        srcIds[i] = loadPackedSource(compiler, &instr->srcs[i], dstMask, vec4TypeId);
     }
 
+    unsigned count = getComponentCount(dstMask);
+    IlcSpvId typeId = emitVectorType(compiler, componentTypeId, count);
+    IlcSpvId intTypeId = emitVectorType(compiler, compiler->intId, count);
+
     switch (instr->opcode) {
     case IL_OP_I_NOT:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpNot, compiler->int4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpNot, intTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_I_OR:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpBitwiseOr, compiler->int4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpBitwiseOr, intTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_I_ADD:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->int4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, intTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_I_MAD: {
-        IlcSpvId mulId = ilcSpvPutAlu(compiler->module, SpvOpIMul, compiler->int4Id, 2, srcIds);
+        IlcSpvId mulId = ilcSpvPutAlu(compiler->module, SpvOpIMul, intTypeId, 2, srcIds);
         IlcSpvId addIds[] = { mulId, srcIds[2] };
-        resId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->int4Id, 2, addIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, intTypeId, 2, addIds);
     } break;
     case IL_OP_I_MUL:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpIMul, compiler->int4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpIMul, intTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_I_NEGATE:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpSNegate, compiler->int4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpSNegate, intTypeId, instr->srcCount, srcIds);
         break;
     case IL_OP_U_DIV:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpUDiv, compiler->uint4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpUDiv, typeId, instr->srcCount, srcIds);
         break;
     case IL_OP_U_MOD:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpUMod, compiler->uint4Id,
-                             instr->srcCount, srcIds);
+        resId = ilcSpvPutAlu(compiler->module, SpvOpUMod, typeId, instr->srcCount, srcIds);
         break;
     case IL_OP_AND:
-        resId = ilcSpvPutAlu(compiler->module, SpvOpBitwiseAnd, compiler->int4Id,
+        resId = ilcSpvPutAlu(compiler->module, SpvOpBitwiseAnd, intTypeId,
                              instr->srcCount, srcIds);
         break;
     case IL_OP_I_SHL:
@@ -1546,45 +2386,47 @@ static void emitIntegerOp(
         } else {
             op = SpvOpShiftRightLogical;
         }
-        const IlcSpvId argIds[] = { srcIds[0], emitShiftMask(compiler, srcIds[1]) };
-        resId = ilcSpvPutAlu(compiler->module, op, compiler->int4Id, 2, argIds);
+        const IlcSpvId argIds[] = { srcIds[0], emitShiftMask(compiler, srcIds[1], count) };
+        resId = ilcSpvPutAlu(compiler->module, op, intTypeId, 2, argIds);
     }   break;
     case IL_OP_U_BIT_EXTRACT: {
-        IlcSpvId widthsId = emitShiftMask(compiler, srcIds[0]);
-        IlcSpvId offsetsId = emitShiftMask(compiler, srcIds[1]);
+        IlcSpvId widthsId = emitShiftMask(compiler, srcIds[0], count);
+        IlcSpvId offsetsId = emitShiftMask(compiler, srcIds[1], count);
         IlcSpvId bfId[4];
-        for (unsigned i = 0; i < 4; i++) {
+        for (unsigned i = 0; i < count; i++) {
             // FIXME handle width + offset >= 32
-            IlcSpvId widthId = emitVectorTrim(compiler, widthsId, compiler->int4Id, i, 1);
-            IlcSpvId offsetId = emitVectorTrim(compiler, offsetsId, compiler->int4Id, i, 1);
-            IlcSpvId baseId = emitVectorTrim(compiler, srcIds[2], compiler->int4Id, i, 1);
+            IlcSpvId widthId = emitPackedComponent(compiler, widthsId, compiler->intId, count, i);
+            IlcSpvId offsetId = emitPackedComponent(compiler, offsetsId, compiler->intId, count, i);
+            IlcSpvId baseId = emitPackedComponent(compiler, srcIds[2], compiler->intId, count, i);
             const IlcSpvId argIds[] = { baseId, offsetId, widthId };
             bfId[i] = ilcSpvPutAlu(compiler->module, SpvOpBitFieldUExtract, compiler->intId,
                                    3, argIds);
         }
-        resId = ilcSpvPutCompositeConstruct(compiler->module, compiler->int4Id, 4, bfId);
+        resId = count == 1 ? bfId[0]
+                           : ilcSpvPutCompositeConstruct(compiler->module, intTypeId, count, bfId);
     }   break;
     case IL_OP_U_BIT_INSERT: {
-        IlcSpvId widthsId = emitShiftMask(compiler, srcIds[0]);
-        IlcSpvId offsetsId = emitShiftMask(compiler, srcIds[1]);
+        IlcSpvId widthsId = emitShiftMask(compiler, srcIds[0], count);
+        IlcSpvId offsetsId = emitShiftMask(compiler, srcIds[1], count);
         IlcSpvId bfId[4];
-        for (unsigned i = 0; i < 4; i++) {
-            IlcSpvId widthId = emitVectorTrim(compiler, widthsId, compiler->int4Id, i, 1);
-            IlcSpvId offsetId = emitVectorTrim(compiler, offsetsId, compiler->int4Id, i, 1);
-            IlcSpvId insertId = emitVectorTrim(compiler, srcIds[2], compiler->int4Id, i, 1);
-            IlcSpvId baseId = emitVectorTrim(compiler, srcIds[3], compiler->int4Id, i, 1);
+        for (unsigned i = 0; i < count; i++) {
+            IlcSpvId widthId = emitPackedComponent(compiler, widthsId, compiler->intId, count, i);
+            IlcSpvId offsetId = emitPackedComponent(compiler, offsetsId, compiler->intId, count, i);
+            IlcSpvId insertId = emitPackedComponent(compiler, srcIds[2], compiler->intId, count, i);
+            IlcSpvId baseId = emitPackedComponent(compiler, srcIds[3], compiler->intId, count, i);
             const IlcSpvId argIds[] = { baseId, insertId, offsetId, widthId };
             bfId[i] = ilcSpvPutAlu(compiler->module, SpvOpBitFieldInsert, compiler->intId,
                                    4, argIds);
         }
-        resId = ilcSpvPutCompositeConstruct(compiler->module, compiler->int4Id, 4, bfId);
+        resId = count == 1 ? bfId[0]
+                           : ilcSpvPutCompositeConstruct(compiler->module, intTypeId, count, bfId);
     }   break;
     default:
         assert(false);
         break;
     }
 
-    storeDestination(compiler, &instr->dsts[0], resId, typeId);
+    storeDestination(compiler, dst, resId, typeId, dstMask);
 }
 
 static void emitIntegerComparisonOp(
@@ -1635,7 +2477,7 @@ static void emitIntegerComparisonOp(
     IlcSpvId resId = ilcSpvPutSelect(compiler->module, compiler->float4Id, condId,
                                      trueCompositeId, falseCompositeId);
 
-    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id);
+    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id, COMP_MASK_XYZW);
 }
 
 static void emitCmovLogical(
@@ -1659,7 +2501,7 @@ static void emitCmovLogical(
     IlcSpvId resId = ilcSpvPutSelect(compiler->module, compiler->float4Id, condId,
                                      srcIds[1], srcIds[2]);
 
-    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id);
+    storeDestination(compiler, &instr->dsts[0], resId, compiler->float4Id, COMP_MASK_XYZW);
 }
 
 static void emitNumThreadPerGroup(
@@ -1691,10 +2533,12 @@ static void emitIf(
     IlcCompiler* compiler,
     const Instruction* instr)
 {
-    const IlcIfElseBlock ifElseBlock = {
+    IlcIfElseBlock ifElseBlock = {
         .labelElseId = ilcSpvAllocId(compiler->module),
         .labelEndId = ilcSpvAllocId(compiler->module),
         .hasElseBlock = false,
+        .ssaIfState = { 0 }, // Initialized below
+        .ssaThenState = { 0 }, // Initialized on else/endif
     };
 
     IlcSpvId srcId = loadSource(compiler, &instr->srcs[0], COMP_MASK_XYZW, compiler->int4Id);
@@ -1702,7 +2546,10 @@ static void emitIf(
     IlcSpvId condId = emitConditionCheck(compiler, srcId, instr->opcode == IL_OP_IF_LOGICALNZ);
     ilcSpvPutSelectionMerge(compiler->module, ifElseBlock.labelEndId);
     ilcSpvPutBranchConditional(compiler->module, condId, labelBeginId, ifElseBlock.labelElseId);
-    ilcSpvPutLabel(compiler->module, labelBeginId);
+    if (compiler->isSsaEnabled) {
+        ifElseBlock.ssaIfState = saveSsaState(compiler);
+    }
+    emitLabel(compiler, labelBeginId);
 
     const IlcControlFlowBlock block = {
         .type = BLOCK_IF_ELSE,
@@ -1721,31 +2568,119 @@ static void emitElse(
         assert(false);
     }
 
+    if (compiler->isSsaEnabled) {
+        block.ifElse.ssaThenState = saveSsaState(compiler);
+    }
     ilcSpvPutBranch(compiler->module, block.ifElse.labelEndId);
-    ilcSpvPutLabel(compiler->module, block.ifElse.labelElseId);
+    emitLabel(compiler, block.ifElse.labelElseId);
+    if (compiler->isSsaEnabled) {
+        restoreSsaState(compiler, &block.ifElse.ssaIfState);
+    }
     block.ifElse.hasElseBlock = true;
 
     pushControlFlowBlock(compiler, &block);
 }
 
+static void addLoopSsaTemps(
+    IlcCompiler* compiler,
+    IlcLoopBlock* loopBlock,
+    const Instruction* instr)
+{
+    const Kernel* kernel = compiler->kernel;
+    unsigned depth = 0;
+
+    // Find the temporaries written before the matching endloop, they need header phis
+    for (unsigned i = instr - kernel->instrs + 1; i < kernel->instrCount; i++) {
+        const Instruction* loopInstr = &kernel->instrs[i];
+
+        if (loopInstr->opcode == IL_OP_WHILE) {
+            depth++;
+        } else if (loopInstr->opcode == IL_OP_ENDLOOP) {
+            if (depth == 0) {
+                break;
+            }
+            depth--;
+        }
+
+        for (unsigned j = 0; j < loopInstr->dstCount; j++) {
+            const Destination* dst = &loopInstr->dsts[j];
+
+            if (dst->registerType != IL_REGTYPE_TEMP) {
+                continue;
+            }
+
+            const IlcRegister* reg = findOrCreateRegister(compiler, dst->registerType,
+                                                          dst->registerNum);
+            unsigned regIndex = reg - compiler->regs;
+            bool isPresent = false;
+
+            for (unsigned k = 0; k < loopBlock->ssaTempCount; k++) {
+                if (loopBlock->ssaTempIndices[k] == regIndex) {
+                    isPresent = true;
+                    break;
+                }
+            }
+
+            if (!isPresent) {
+                loopBlock->ssaTempCount++;
+                loopBlock->ssaTempIndices = realloc(loopBlock->ssaTempIndices,
+                                                    sizeof(unsigned) * loopBlock->ssaTempCount);
+                loopBlock->ssaTempIndices[loopBlock->ssaTempCount - 1] = regIndex;
+            }
+        }
+    }
+
+    // Continue block values are referenced by the header phis before being emitted
+    loopBlock->ssaContinueIds = malloc(sizeof(IlcSpvId) * loopBlock->ssaTempCount);
+    for (unsigned i = 0; i < loopBlock->ssaTempCount; i++) {
+        loopBlock->ssaContinueIds[i] = ilcSpvAllocId(compiler->module);
+    }
+}
+
 static void emitWhile(
     IlcCompiler* compiler,
     const Instruction* instr)
 {
-    const IlcLoopBlock loopBlock = {
+    IlcLoopBlock loopBlock = {
         .labelHeaderId = ilcSpvAllocId(compiler->module),
         .labelContinueId = ilcSpvAllocId(compiler->module),
         .labelBreakId = ilcSpvAllocId(compiler->module),
+        .ssaTempCount = 0,
+        .ssaTempIndices = NULL,
+        .ssaContinueIds = NULL,
+        .ssaContinueStateCount = 0,
+        .ssaContinueStates = NULL,
+        .ssaBreakStateCount = 0,
+        .ssaBreakStates = NULL,
     };
 
+    IlcSpvId labelPreheaderId = compiler->currentLabelId;
+
+    if (compiler->isSsaEnabled) {
+        addLoopSsaTemps(compiler, &loopBlock, instr);
+    }
+
     ilcSpvPutBranch(compiler->module, loopBlock.labelHeaderId);
-    ilcSpvPutLabel(compiler->module, loopBlock.labelHeaderId);
+    emitLabel(compiler, loopBlock.labelHeaderId);
+
+    for (unsigned i = 0; i < loopBlock.ssaTempCount; i++) {
+        unsigned regIndex = loopBlock.ssaTempIndices[i];
+        const IlcSpvId ids[] = {
+            getSsaValue(compiler, compiler->ssaValues, compiler->regCount, regIndex),
+            labelPreheaderId,
+            loopBlock.ssaContinueIds[i],
+            loopBlock.labelContinueId,
+        };
+
+        compiler->ssaValues[regIndex] = ilcSpvPutPhi(compiler->module, compiler->float4Id, 0,
+                                                     4, ids);
+    }
 
     ilcSpvPutLoopMerge(compiler->module, loopBlock.labelBreakId, loopBlock.labelContinueId);
 
     IlcSpvId labelBeginId = ilcSpvAllocId(compiler->module);
     ilcSpvPutBranch(compiler->module, labelBeginId);
-    ilcSpvPutLabel(compiler->module, labelBeginId);
+    emitLabel(compiler, labelBeginId);
 
     const IlcControlFlowBlock block = {
         .type = BLOCK_LOOP,
@@ -1766,18 +2701,40 @@ static void emitEndIf(
 
     if (compiler->isAfterReturn) {
         // Declare a new block
-        ilcSpvPutLabel(compiler->module, ilcSpvAllocId(compiler->module));
+        emitLabel(compiler, ilcSpvAllocId(compiler->module));
         compiler->isAfterReturn = false;
     }
 
-    if (!block.ifElse.hasElseBlock) {
+    IlcIfElseBlock ifElseBlock = block.ifElse;
+
+    if (!ifElseBlock.hasElseBlock) {
         // If no else block was declared, insert a dummy one
-        ilcSpvPutBranch(compiler->module, block.ifElse.labelEndId);
-        ilcSpvPutLabel(compiler->module, block.ifElse.labelElseId);
+        if (compiler->isSsaEnabled) {
+            ifElseBlock.ssaThenState = saveSsaState(compiler);
+        }
+        ilcSpvPutBranch(compiler->module, ifElseBlock.labelEndId);
+        emitLabel(compiler, ifElseBlock.labelElseId);
+        if (compiler->isSsaEnabled) {
+            restoreSsaState(compiler, &ifElseBlock.ssaIfState);
+        }
     }
 
-    ilcSpvPutBranch(compiler->module, block.ifElse.labelEndId);
-    ilcSpvPutLabel(compiler->module, block.ifElse.labelEndId);
+    IlcSsaState ssaElseState = { 0 };
+    if (compiler->isSsaEnabled) {
+        ssaElseState = saveSsaState(compiler);
+    }
+
+    ilcSpvPutBranch(compiler->module, ifElseBlock.labelEndId);
+    emitLabel(compiler, ifElseBlock.labelEndId);
+
+    if (compiler->isSsaEnabled) {
+        const IlcSsaState states[] = { ifElseBlock.ssaThenState, ssaElseState };
+        emitSsaMerge(compiler, 2, states);
+
+        free(ifElseBlock.ssaIfState.values);
+        free(ifElseBlock.ssaThenState.values);
+        free(ssaElseState.values);
+    }
 }
 
 static void emitEndLoop(
@@ -1790,18 +2747,41 @@ static void emitEndLoop(
         assert(false);
     }
 
-    ilcSpvPutBranch(compiler->module, block.loop.labelContinueId);
-    ilcSpvPutLabel(compiler->module, block.loop.labelContinueId);
+    IlcLoopBlock loopBlock = block.loop;
+
+    if (compiler->isSsaEnabled) {
+        const IlcSsaState state = saveSsaState(compiler);
+        addSsaState(&loopBlock.ssaContinueStateCount, &loopBlock.ssaContinueStates, &state);
+    }
+
+    ilcSpvPutBranch(compiler->module, loopBlock.labelContinueId);
+    emitLabel(compiler, loopBlock.labelContinueId);
+
+    for (unsigned i = 0; i < loopBlock.ssaTempCount; i++) {
+        emitSsaPhi(compiler, loopBlock.ssaContinueIds[i], loopBlock.ssaTempIndices[i],
+                   loopBlock.ssaContinueStateCount, loopBlock.ssaContinueStates);
+    }
+
+    ilcSpvPutBranch(compiler->module, loopBlock.labelHeaderId);
+    emitLabel(compiler, loopBlock.labelBreakId);
+
+    if (compiler->isSsaEnabled) {
+        emitSsaMerge(compiler, loopBlock.ssaBreakStateCount, loopBlock.ssaBreakStates);
 
-    ilcSpvPutBranch(compiler->module, block.loop.labelHeaderId);
-    ilcSpvPutLabel(compiler->module, block.loop.labelBreakId);
+        freeSsaStates(loopBlock.ssaContinueStateCount, loopBlock.ssaContinueStates);
+        freeSsaStates(loopBlock.ssaBreakStateCount, loopBlock.ssaBreakStates);
+        free(loopBlock.ssaTempIndices);
+        free(loopBlock.ssaContinueIds);
+        free(loopBlock.ssaContinueStates);
+        free(loopBlock.ssaBreakStates);
+    }
 }
 
 static void emitBreak(
     IlcCompiler* compiler,
     const Instruction* instr)
 {
-    const IlcControlFlowBlock* block = findControlFlowBlock(compiler, BLOCK_LOOP);
+    IlcControlFlowBlock* block = findControlFlowBlock(compiler, BLOCK_LOOP);
     if (block == NULL) {
         LOGE("no matching loop block was found\n");
         assert(false);
@@ -1821,22 +2801,32 @@ static void emitBreak(
         assert(false);
     }
 
-    ilcSpvPutLabel(compiler->module, labelId);
+    if (compiler->isSsaEnabled) {
+        const IlcSsaState state = saveSsaState(compiler);
+        addSsaState(&block->loop.ssaBreakStateCount, &block->loop.ssaBreakStates, &state);
+    }
+
+    emitLabel(compiler, labelId);
 }
 
 static void emitContinue(
     IlcCompiler* compiler,
     const Instruction* instr)
 {
-    const IlcControlFlowBlock* block = findControlFlowBlock(compiler, BLOCK_LOOP);
+    IlcControlFlowBlock* block = findControlFlowBlock(compiler, BLOCK_LOOP);
     if (block == NULL) {
         LOGE("no matching loop block was found\n");
         assert(false);
     }
 
+    if (compiler->isSsaEnabled) {
+        const IlcSsaState state = saveSsaState(compiler);
+        addSsaState(&block->loop.ssaContinueStateCount, &block->loop.ssaContinueStates, &state);
+    }
+
     IlcSpvId labelId = ilcSpvAllocId(compiler->module);
     ilcSpvPutBranch(compiler->module, block->loop.labelContinueId);
-    ilcSpvPutLabel(compiler->module, labelId);
+    emitLabel(compiler, labelId);
 }
 
 static void emitDiscard(
@@ -1850,13 +2840,13 @@ static void emitDiscard(
     IlcSpvId condId = emitConditionCheck(compiler, srcId, instr->opcode == IL_OP_DISCARD_LOGICALNZ);
     ilcSpvPutSelectionMerge(compiler->module, labelEndId);
     ilcSpvPutBranchConditional(compiler->module, condId, labelBeginId, labelEndId);
-    ilcSpvPutLabel(compiler->module, labelBeginId);
+    emitLabel(compiler, labelBeginId);
 
     ilcSpvPutCapability(compiler->module, SpvCapabilityDemoteToHelperInvocationEXT);
     ilcSpvPutDemoteToHelperInvocation(compiler->module); // Direct3D discard
 
     ilcSpvPutBranch(compiler->module, labelEndId);
-    ilcSpvPutLabel(compiler->module, labelEndId);
+    emitLabel(compiler, labelEndId);
 }
 
 static void emitFence(
@@ -1926,7 +2916,7 @@ static void emitLoad(
     IlcSpvId resourceId = ilcSpvPutLoad(compiler->module, resource->typeId, resource->id);
     IlcSpvId fetchId = ilcSpvPutImageFetch(compiler->module, resource->texelTypeId, resourceId,
                                            srcId, operandsMask, operandIdCount, operandIds);
-    storeDestination(compiler, dst, fetchId, resource->texelTypeId);
+    storeDestination(compiler, dst, fetchId, resource->texelTypeId, COMP_MASK_XYZW);
 }
 
 static void emitResinfo(
@@ -1970,11 +2960,11 @@ static void emitResinfo(
     IlcSpvId infoId = ilcSpvPutVectorShuffle(compiler->module, compiler->int4Id,
                                              zeroLevelsId, sizesId, 4, components);
     if (ilReturnType) {
-        storeDestination(compiler, dst, infoId, compiler->int4Id);
+        storeDestination(compiler, dst, infoId, compiler->int4Id, COMP_MASK_XYZW);
     } else {
         IlcSpvId fInfoId = ilcSpvPutAlu(compiler->module, SpvOpConvertSToF, compiler->float4Id,
                                         1, &infoId);
-        storeDestination(compiler, dst, fInfoId, compiler->float4Id);
+        storeDestination(compiler, dst, fInfoId, compiler->float4Id, COMP_MASK_XYZW);
     }
 
 }
@@ -2056,15 +3046,103 @@ static void emitSample(
         IlcSpvId sampleId = ilcSpvPutImageSample(compiler->module, sampleOp, resource->texelTypeId,
                                                  sampledImageId, coordinateId, drefId, operandsMask,
                                                  operandIdCount, operandIds);
-        storeDestination(compiler, dst, sampleId, resource->texelTypeId);
+        storeDestination(compiler, dst, sampleId, resource->texelTypeId, COMP_MASK_XYZW);
     } else {
         // Store the scalar result in dst.x
         IlcSpvId sampleId = ilcSpvPutImageSample(compiler->module, sampleOp, compiler->floatId,
                                                  sampledImageId, coordinateId, drefId, operandsMask,
                                                  operandIdCount, operandIds);
         sampleId = emitVectorGrow(compiler, sampleId, compiler->floatId, 1);
-        storeDestination(compiler, dst, sampleId, compiler->float4Id);
+        storeDestination(compiler, dst, sampleId, compiler->float4Id, COMP_MASK_XYZW);
+    }
+}
+
+static IlcSpvId emitBufferAccessChains(
+    IlcCompiler* compiler,
+    const IlcResource* resource,
+    SpvStorageClass storageClass,
+    IlcSpvId indexId,
+    IlcSpvId offsetId,
+    unsigned count,
+    IlcSpvId* ptrIds)
+{
+    // Returns a pointer to a whole vector element if the word at (index * stride + offset) / 4
+    // is known to start one, otherwise fills ptrIds with pointers to the next count words
+    IlcSpvModule* module = compiler->module;
+    IlcSpvId zeroId = ilcSpvPutConstant(module, compiler->intId, ZERO_LITERAL);
+    IlcSpvId oneId = ilcSpvPutConstant(module, compiler->intId, 1);
+    IlcSpvId ptrTypeId = ilcSpvPutPointerType(module, storageClass, resource->texelTypeId);
+    // Storage buffer arrays are wrapped in a block
+    unsigned blockIndexCount = storageClass == SpvStorageClassStorageBuffer ? 1 : 0;
+
+    if (!resource->isVectorized) {
+        // addr = (index * stride + offset) / 4
+        const IlcSpvId mulIds[] = { indexId, resource->strideId };
+        IlcSpvId baseId = ilcSpvPutAlu(module, SpvOpIMul, compiler->intId, 2, mulIds);
+        const IlcSpvId addIds[] = { baseId, offsetId };
+        IlcSpvId byteAddrId = ilcSpvPutAlu(module, SpvOpIAdd, compiler->intId, 2, addIds);
+        const IlcSpvId divIds[] = { byteAddrId, ilcSpvPutConstant(module, compiler->intId, 4) };
+        IlcSpvId wordAddrId = ilcSpvPutAlu(module, SpvOpSDiv, compiler->intId, 2, divIds);
+
+        for (unsigned i = 0; i < count; i++) {
+            if (i > 0) {
+                // Increment address
+                const IlcSpvId incrementIds[] = { wordAddrId, oneId };
+                wordAddrId = ilcSpvPutAlu(module, SpvOpIAdd, compiler->intId, 2, incrementIds);
+            }
+
+            const IlcSpvId indexIds[] = { zeroId, wordAddrId };
+            ptrIds[i] = ilcSpvPutAccessChain(module, ptrTypeId, resource->id,
+                                             blockIndexCount + 1, &indexIds[1 - blockIndexCount]);
+        }
+
+        return 0;
     }
+
+    // element = index * (stride / 16) + word / 4, component = word % 4, with word = offset / 4.
+    // Constant offsets fold to constant indices
+    IlcSpvWord stride = 0;
+    ilcSpvGetScalarConstant(module, resource->strideId, &stride);
+    IlcSpvId twoId = ilcSpvPutConstant(module, compiler->intId, 2);
+    const IlcSpvId mulIds[] = { indexId, ilcSpvPutConstant(module, compiler->intId, stride / 16) };
+    IlcSpvId baseId = ilcSpvPutAlu(module, SpvOpIMul, compiler->intId, 2, mulIds);
+    const IlcSpvId shiftIds[] = { offsetId, twoId };
+    IlcSpvId wordId = ilcSpvPutAlu(module, SpvOpShiftRightArithmetic, compiler->intId,
+                                   2, shiftIds);
+    IlcSpvId threeId = ilcSpvPutConstant(module, compiler->intId, 3);
+
+    for (unsigned i = 0; i < count; i++) {
+        if (i > 0) {
+            // Increment address
+            const IlcSpvId incrementIds[] = { wordId, oneId };
+            wordId = ilcSpvPutAlu(module, SpvOpIAdd, compiler->intId, 2, incrementIds);
+        }
+
+        const IlcSpvId elementShiftIds[] = { wordId, twoId };
+        IlcSpvId elementOffsetId = ilcSpvPutAlu(module, SpvOpShiftRightArithmetic,
+                                                compiler->intId, 2, elementShiftIds);
+        const IlcSpvId elementAddIds[] = { baseId, elementOffsetId };
+        IlcSpvId elementId = ilcSpvPutAlu(module, SpvOpIAdd, compiler->intId, 2, elementAddIds);
+        const IlcSpvId componentAndIds[] = { wordId, threeId };
+        IlcSpvId componentId = ilcSpvPutAlu(module, SpvOpBitwiseAnd, compiler->intId,
+                                            2, componentAndIds);
+
+        IlcSpvWord component;
+        if (i == 0 && ilcSpvGetScalarConstant(module, componentId, &component) &&
+            component == 0) {
+            IlcSpvId vecTypeId = ilcSpvPutVectorType(module, resource->texelTypeId, 4);
+            IlcSpvId vecPtrTypeId = ilcSpvPutPointerType(module, storageClass, vecTypeId);
+            const IlcSpvId indexIds[] = { zeroId, elementId };
+            return ilcSpvPutAccessChain(module, vecPtrTypeId, resource->id,
+                                        blockIndexCount + 1, &indexIds[1 - blockIndexCount]);
+        }
+
+        const IlcSpvId indexIds[] = { zeroId, elementId, componentId };
+        ptrIds[i] = ilcSpvPutAccessChain(module, ptrTypeId, resource->id,
+                                         blockIndexCount + 2, &indexIds[1 - blockIndexCount]);
+    }
+
+    return 0;
 }
 
 static void emitLdsLoadVec(
@@ -2086,37 +3164,24 @@ static void emitLdsLoadVec(
     IlcSpvId indexId = emitVectorTrim(compiler, index4Id, compiler->int4Id, COMP_INDEX_X, 1);
     IlcSpvId offsetId = emitVectorTrim(compiler, offset4Id, compiler->int4Id, COMP_INDEX_X, 1);
 
-    // addr = (index * stride + offset) / 4
-    const IlcSpvId mulIds[] = { indexId, resource->strideId };
-    IlcSpvId baseId = ilcSpvPutAlu(compiler->module, SpvOpIMul, compiler->intId, 2, mulIds);
-    const IlcSpvId addIds[] = { baseId, offsetId };
-    IlcSpvId byteAddrId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId, 2, addIds);
-    const IlcSpvId divIds[] = {
-        byteAddrId, ilcSpvPutConstant(compiler->module, compiler->intId, 4)
-    };
-    IlcSpvId wordAddrId = ilcSpvPutAlu(compiler->module, SpvOpSDiv, compiler->intId, 2, divIds);
-
-    IlcSpvId oneId = ilcSpvPutConstant(compiler->module, compiler->intId, 1);
-    IlcSpvId ptrTypeId = ilcSpvPutPointerType(compiler->module, SpvStorageClassWorkgroup,
-                                              resource->texelTypeId);
+    IlcSpvId resTypeId = ilcSpvPutVectorType(compiler->module, resource->texelTypeId, 4);
+    IlcSpvId ptrIds[4];
+    IlcSpvId vecPtrId = emitBufferAccessChains(compiler, resource, SpvStorageClassWorkgroup,
+                                               indexId, offsetId, 4, ptrIds);
 
-    IlcSpvId componentIds[4];
-    for (unsigned i = 0; i < 4; i++) {
-        if (i > 0) {
-            // Increment address
-            const IlcSpvId incrementIds[] = { wordAddrId, oneId };
-            wordAddrId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId,
-                                      2, incrementIds);
+    IlcSpvId resId = 0;
+    if (vecPtrId != 0) {
+        resId = ilcSpvPutLoad(compiler->module, resTypeId, vecPtrId);
+    } else {
+        IlcSpvId componentIds[4];
+        for (unsigned i = 0; i < 4; i++) {
+            componentIds[i] = ilcSpvPutLoad(compiler->module, resource->texelTypeId, ptrIds[i]);
         }
 
-        IlcSpvId ptrId = ilcSpvPutAccessChain(compiler->module, ptrTypeId, resource->id,
-                                              1, &wordAddrId);
-        componentIds[i] = ilcSpvPutLoad(compiler->module, resource->texelTypeId, ptrId);
+        resId = ilcSpvPutCompositeConstruct(compiler->module, resTypeId, 4, componentIds);
     }
 
-    IlcSpvId resTypeId = ilcSpvPutVectorType(compiler->module, resource->texelTypeId, 4);
-    IlcSpvId resId = ilcSpvPutCompositeConstruct(compiler->module, resTypeId, 4, componentIds);
-    storeDestination(compiler, dst, resId, resTypeId);
+    storeDestination(compiler, dst, resId, resTypeId, COMP_MASK_XYZW);
 }
 
 static void emitLdsStoreVec(
@@ -2139,35 +3204,34 @@ static void emitLdsStoreVec(
     IlcSpvId indexId = emitVectorTrim(compiler, index4Id, compiler->int4Id, COMP_INDEX_X, 1);
     IlcSpvId offsetId = emitVectorTrim(compiler, offset4Id, compiler->int4Id, COMP_INDEX_X, 1);
 
-    // addr = (index * stride + offset) / 4
-    const IlcSpvId mulIds[] = { indexId, resource->strideId };
-    IlcSpvId baseId = ilcSpvPutAlu(compiler->module, SpvOpIMul, compiler->intId, 2, mulIds);
-    const IlcSpvId addIds[] = { baseId, offsetId };
-    IlcSpvId byteAddrId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId, 2, addIds);
-    const IlcSpvId divIds[] = {
-        byteAddrId, ilcSpvPutConstant(compiler->module, compiler->intId, 4)
-    };
-    IlcSpvId wordAddrId = ilcSpvPutAlu(compiler->module, SpvOpSDiv, compiler->intId, 2, divIds);
+    // Write up to four components based on the destination mask
+    unsigned count = 0;
+    while (count < 4 && dst->component[count] != IL_MODCOMP_NOWRITE) {
+        count++;
+    }
+
+    IlcSpvId ptrIds[4];
+    IlcSpvId vecPtrId = emitBufferAccessChains(compiler, resource, SpvStorageClassWorkgroup,
+                                               indexId, offsetId, count, ptrIds);
+
+    if (vecPtrId != 0 && count == 4) {
+        ilcSpvPutStore(compiler->module, vecPtrId, dataId);
+        return;
+    }
 
-    IlcSpvId oneId = ilcSpvPutConstant(compiler->module, compiler->intId, 1);
     IlcSpvId ptrTypeId = ilcSpvPutPointerType(compiler->module, SpvStorageClassWorkgroup,
                                               resource->texelTypeId);
 
-    // Write up to four components based on the destination mask
-    for (unsigned i = 0; i < 4; i++) {
-        if (dst->component[i] == IL_MODCOMP_NOWRITE) {
-            break;
-        }
+    for (unsigned i = 0; i < count; i++) {
+        IlcSpvId ptrId = ptrIds[i];
 
-        if (i > 0) {
-            // Increment address
-            const IlcSpvId incrementIds[] = { wordAddrId, oneId };
-            wordAddrId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId,
-                                      2, incrementIds);
+        if (vecPtrId != 0) {
+            // Partial write to an aligned element
+            IlcSpvId componentIndexId = ilcSpvPutConstant(compiler->module, compiler->intId, i);
+            ptrId = ilcSpvPutAccessChain(compiler->module, ptrTypeId, vecPtrId,
+                                         1, &componentIndexId);
         }
 
-        IlcSpvId ptrId = ilcSpvPutAccessChain(compiler->module, ptrTypeId, resource->id,
-                                              1, &wordAddrId);
         IlcSpvId componentId = emitVectorTrim(compiler, dataId, compiler->uint4Id, i, 1);
         ilcSpvPutStore(compiler->module, ptrId, componentId);
     }
@@ -2192,7 +3256,7 @@ static void emitUavLoad(
     IlcSpvId resourceId = ilcSpvPutLoad(compiler->module, resource->typeId, resource->id);
     IlcSpvId addressId = loadSource(compiler, &instr->srcs[0], COMP_MASK_XYZW, compiler->int4Id);
     IlcSpvId readId = ilcSpvPutImageRead(compiler->module, texel4TypeId, resourceId, addressId);
-    storeDestination(compiler, dst, readId, texel4TypeId);
+    storeDestination(compiler, dst, readId, texel4TypeId, COMP_MASK_XYZW);
 }
 
 static void emitUavStore(
@@ -2256,7 +3320,7 @@ static void emitUavAtomicOp(
 
     if (instr->dstCount > 0) {
         IlcSpvId resId = emitVectorGrow(compiler, readId, resource->texelTypeId, 1);
-        storeDestination(compiler, &instr->dsts[0], resId, vecTypeId);
+        storeDestination(compiler, &instr->dsts[0], resId, vecTypeId, COMP_MASK_XYZW);
     }
 }
 
@@ -2283,89 +3347,33 @@ static void emitStructuredSrvLoad(
     IlcSpvId indexId = emitVectorTrim(compiler, srcId, compiler->int4Id, COMP_INDEX_X, 1);
     IlcSpvId offsetId = emitVectorTrim(compiler, srcId, compiler->int4Id, COMP_INDEX_Y, 1);
 
-    // addr = (index * stride + offset) / 4
-    const IlcSpvId mulIds[] = { indexId, resource->strideId };
-    IlcSpvId baseId = ilcSpvPutAlu(compiler->module, SpvOpIMul, compiler->intId, 2, mulIds);
-    const IlcSpvId addIds[] = { baseId, offsetId };
-    IlcSpvId byteAddrId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId, 2, addIds);
-    const IlcSpvId divIds[] = {
-        byteAddrId, ilcSpvPutConstant(compiler->module, compiler->intId, 4)
-    };
-    IlcSpvId wordAddrId = ilcSpvPutAlu(compiler->module, SpvOpSDiv, compiler->intId, 2, divIds);
-
     // Read up to four components based on the destination mask
-    IlcSpvId zeroId = ilcSpvPutConstant(compiler->module, compiler->intId, ZERO_LITERAL);
-    IlcSpvId oneId = ilcSpvPutConstant(compiler->module, compiler->intId, 1);
-    IlcSpvId ptrTypeId = ilcSpvPutPointerType(compiler->module, SpvStorageClassStorageBuffer,
-                                              resource->texelTypeId);
-    IlcSpvId fZeroId = ilcSpvPutConstant(compiler->module, compiler->floatId, ZERO_LITERAL);
-    IlcSpvWord constituents[] = { fZeroId, fZeroId, fZeroId, fZeroId };
-
-    for (unsigned i = 0; i < 4; i++) {
-        if (dst->component[i] == IL_MODCOMP_NOWRITE) {
-            break;
-        }
-
-        if (i > 0) {
-            // Increment address
-            const IlcSpvId incrementIds[] = { wordAddrId, oneId };
-            wordAddrId = ilcSpvPutAlu(compiler->module, SpvOpIAdd, compiler->intId,
-                                      2, incrementIds);
-        }
-
-        const IlcSpvId indexIds[] = { zeroId, wordAddrId };
-        IlcSpvId ptrId = ilcSpvPutAccessChain(compiler->module, ptrTypeId, resource->id,
-                                              2, indexIds);
-        constituents[i] = ilcSpvPutLoad(compiler->module, resource->texelTypeId, ptrId);
+    unsigned count = 0;
+    while (count < 4 && dst->component[count] != IL_MODCOMP_NOWRITE) {
+        count++;
     }
 
-    IlcSpvId loadId = ilcSpvPutCompositeConstruct(compiler->module, compiler->float4Id,
-                                                  4, constituents);
-    storeDestination(compiler, dst, loadId, compiler->float4Id);
-}
-
-static void emitImplicitInput(
-    IlcCompiler* compiler,
-    SpvBuiltIn spvBuiltIn,
-    uint32_t ilType,
-    unsigned componentCount,
-    const char* name)
-{
-    IlcSpvId componentTypeId = compiler->uintId;
-    IlcSpvId inputTypeId = ilcSpvPutVectorType(compiler->module, componentTypeId,
-                                               componentCount);
-    IlcSpvId inputId = emitVariable(compiler, inputTypeId, SpvStorageClassInput);
-
-    IlcSpvWord builtInType = spvBuiltIn;
-    ilcSpvPutDecoration(compiler->module, inputId, SpvDecorationBuiltIn, 1, &builtInType);
-
-    const IlcRegister reg = {
-        .id = inputId,
-        .typeId = inputTypeId,
-        .componentTypeId = componentTypeId,
-        .componentCount = componentCount,
-        .ilType = ilType,
-        .ilNum = 0,
-        .ilImportUsage = 0,
-        .ilInterpMode = 0,
-    };
+    IlcSpvId ptrIds[4];
+    IlcSpvId vecPtrId = emitBufferAccessChains(compiler, resource, SpvStorageClassStorageBuffer,
+                                               indexId, offsetId, count, ptrIds);
 
-    addRegister(compiler, &reg, name);
-}
+    IlcSpvId loadId = 0;
+    if (vecPtrId != 0) {
+        // Aligned elements are read whole, unused components are masked out on store
+        loadId = ilcSpvPutLoad(compiler->module, compiler->float4Id, vecPtrId);
+    } else {
+        IlcSpvId fZeroId = ilcSpvPutConstant(compiler->module, compiler->floatId, ZERO_LITERAL);
+        IlcSpvWord constituents[] = { fZeroId, fZeroId, fZeroId, fZeroId };
 
-static void emitImplicitInputs(
-    IlcCompiler* compiler)
-{
-    if (compiler->kernel->shaderType == IL_SHADER_COMPUTE) {
-        // TODO declare on-demand
-        emitImplicitInput(compiler, SpvBuiltInLocalInvocationId, IL_REGTYPE_THREAD_ID_IN_GROUP,
-                          3, "vTidInGrp");
-        emitImplicitInput(compiler, SpvBuiltInGlobalInvocationId, IL_REGTYPE_ABSOLUTE_THREAD_ID,
-                          3, "vAbsTid");
-        emitImplicitInput(compiler, SpvBuiltInWorkgroupId, IL_REGTYPE_THREAD_GROUP_ID,
-                          3, "vThreadGrpId");
+        for (unsigned i = 0; i < count; i++) {
+            constituents[i] = ilcSpvPutLoad(compiler->module, resource->texelTypeId, ptrIds[i]);
+        }
 
+        loadId = ilcSpvPutCompositeConstruct(compiler->module, compiler->float4Id,
+                                             4, constituents);
     }
+
+    storeDestination(compiler, dst, loadId, compiler->float4Id, COMP_MASK_XYZW);
 }
 
 static void emitInstr(
@@ -2476,6 +3484,9 @@ static void emitInstr(
     case IL_DCL_INDEXED_TEMP_ARRAY:
         emitIndexedTempArray(compiler, instr);
         break;
+    case IL_DCL_CONST_BUFFER:
+        emitConstBuffer(compiler, instr);
+        break;
     case IL_DCL_LITERAL:
         emitLiteral(compiler, instr);
         break;
@@ -2553,7 +3564,7 @@ static void emitInstr(
         const IlcSpvWord constituents[] = { zeroId, zeroId, zeroId, zeroId };
         IlcSpvId zero4Id = ilcSpvPutCompositeConstruct(compiler->module, compiler->int4Id,
                                                        4, constituents);
-        storeDestination(compiler, &instr->dsts[0], zero4Id, compiler->int4Id);
+        storeDestination(compiler, &instr->dsts[0], zero4Id, compiler->int4Id, COMP_MASK_XYZW);
     }   break;
     default:
         LOGW("unhandled instruction %d\n", instr->opcode);
@@ -2595,6 +3606,11 @@ static void emitEntryPoint(
     for (int i = 0; i < compiler->regCount; i++) {
         const IlcRegister* reg = &compiler->regs[i];
 
+        if (reg->id == 0 || reg->ilType == IL_REGTYPE_LITERAL) {
+            // SSA temporary or constant
+            continue;
+        }
+
         interfaces[interfaceIndex] = reg->id;
         interfaceIndex++;
     }
@@ -2612,8 +3628,10 @@ static void emitEntryPoint(
     }
 
     ilcSpvPutEntryPoint(compiler->module, compiler->entryPointId, execution, name,
-                        interfaceCount, interfaces);
-    ilcSpvPutName(compiler->module, compiler->entryPointId, name);
+                        interfaceIndex, interfaces);
+    if (compiler->hasDebugInfo) {
+        ilcSpvPutName(compiler->module, compiler->entryPointId, name);
+    }
 
     switch (compiler->kernel->shaderType) {
     case IL_SHADER_PIXEL:
@@ -2631,11 +3649,15 @@ IlcShader ilcCompileKernel(
     const char* name)
 {
     IlcSpvModule module;
+    unsigned options = ilcGetOptions();
+    bool hasDebugInfo = (options & ILC_OPTION_DEBUG_INFO) != 0;
 
     ilcSpvInit(&module);
 
-    IlcSpvId nameId = ilcSpvPutString(&module, name);
-    ilcSpvPutSource(&module, nameId);
+    if (hasDebugInfo) {
+        IlcSpvId nameId = ilcSpvPutString(&module, name);
+        ilcSpvPutSource(&module, nameId);
+    }
 
     IlcSpvId uintId = ilcSpvPutIntType(&module, false);
     IlcSpvId intId = ilcSpvPutIntType(&module, true);
@@ -2657,18 +3679,28 @@ IlcShader ilcCompileKernel(
         .boolId = boolId,
         .bool4Id = ilcSpvPutVectorType(&module, boolId, 4),
         .regCount = 0,
+        .regCapacity = 0,
         .regs = NULL,
+        .regMaps = { { 0, NULL } },
+        .isSsaEnabled = (options & ILC_OPTION_SSA) != 0,
+        .hasDebugInfo = hasDebugInfo,
+        .isLinkConstSpecEnabled = (options & ILC_OPTION_SPECIALIZE_LINK_CONSTS) != 0,
+        .ssaValues = NULL,
+        .currentLabelId = 0,
+        .cachedSourceCount = 0,
+        .cachedSources = { { 0 } },
         .resourceCount = 0,
         .resources = NULL,
         .samplerCount = 0,
         .samplers = NULL,
+        .specConstantCount = 0,
+        .specConstants = NULL,
         .controlFlowBlockCount = 0,
         .controlFlowBlocks = NULL,
         .isInFunction = true,
         .isAfterReturn = false,
     };
 
-    emitImplicitInputs(&compiler);
     emitFunc(&compiler, compiler.entryPointId);
 
     if (compiler.kernel->shaderType == IL_SHADER_HULL ||
@@ -2685,8 +3717,13 @@ IlcShader ilcCompileKernel(
     emitEntryPoint(&compiler);
 
     free(compiler.regs);
+    for (int i = 0; i < IL_REGTYPE_LAST; i++) {
+        free(compiler.regMaps[i].indices);
+    }
+    free(compiler.ssaValues);
     free(compiler.resources);
     free(compiler.samplers);
+    free(compiler.specConstants);
     free(compiler.controlFlowBlocks);
     ilcSpvFinish(&module);
 
@@ -120,6 +120,27 @@ static const OpcodeInfo mOpcodeInfos[IL_OP_LAST] = {
     [IL_UNK_660] = { IL_UNK_660, 1, 0, 0 }, // FIXME undocumented
 };
 
+typedef struct {
+    uint8_t* head;
+    uint8_t* tail;
+    bool failed; // Set when the stream needs more space than its token count allows
+} IlcArena;
+
+static void* allocFromTail(
+    IlcArena* arena,
+    size_t size)
+{
+    // Keep operands 8-byte aligned
+    size = (size + 7) & ~(size_t)7;
+    if ((size_t)(arena->tail - arena->head) < size) {
+        arena->failed = true;
+        return NULL;
+    }
+
+    arena->tail -= size;
+    return arena->tail;
+}
+
 static bool hasIndexedResourceSampler(
     const Instruction* instr)
 {
@@ -132,6 +153,7 @@ static bool hasIndexedResourceSampler(
 }
 
 static unsigned decodeSource(
+    IlcArena* arena,
     Source* src,
     const Token* token);
 
@@ -195,6 +217,7 @@ static unsigned decodeIlVersion(
 }
 
 static unsigned decodeDestination(
+    IlcArena* arena,
     Destination* dst,
     const Token* token)
 {
@@ -234,8 +257,11 @@ static unsigned decodeDestination(
 
     if (relativeAddress == IL_ADDR_ABSOLUTE) {
         if (dimension) {
-            dst->absoluteSrc = malloc(sizeof(Source));
-            idx += decodeSource(dst->absoluteSrc, &token[idx]);
+            dst->absoluteSrc = allocFromTail(arena, sizeof(Source));
+            if (dst->absoluteSrc == NULL) {
+                return idx;
+            }
+            idx += decodeSource(arena, dst->absoluteSrc, &token[idx]);
         }
     } else if (relativeAddress == IL_ADDR_RELATIVE) {
         // TODO
@@ -243,9 +269,12 @@ static unsigned decodeDestination(
         assert(!dimension);
     } else if (relativeAddress == IL_ADDR_REG_RELATIVE) {
         dst->relativeSrcCount = dimension ? 2 : 1;
-        dst->relativeSrcs = malloc(dst->relativeSrcCount * sizeof(Source));
+        dst->relativeSrcs = allocFromTail(arena, dst->relativeSrcCount * sizeof(Source));
+        if (dst->relativeSrcs == NULL) {
+            return idx;
+        }
         for (unsigned i = 0; i < dst->relativeSrcCount; i++) {
-            idx += decodeSource(&dst->relativeSrcs[i], &token[idx]);
+            idx += decodeSource(arena, &dst->relativeSrcs[i], &token[idx]);
         }
     } else {
         assert(false);
@@ -265,6 +294,7 @@ static unsigned decodeDestination(
 }
 
 static unsigned decodeSource(
+    IlcArena* arena,
     Source* src,
     const Token* token)
 {
@@ -312,8 +342,11 @@ static unsigned decodeSource(
     if (relativeAddress == IL_ADDR_ABSOLUTE) {
         if (dimension) {
             src->srcCount = 1;
-            src->srcs = malloc(sizeof(Source));
-            idx += decodeSource(&src->srcs[0], &token[idx]);
+            src->srcs = allocFromTail(arena, sizeof(Source));
+            if (src->srcs == NULL) {
+                return idx;
+            }
+            idx += decodeSource(arena, &src->srcs[0], &token[idx]);
         }
     } else if (relativeAddress == IL_ADDR_RELATIVE) {
         // TODO
@@ -321,9 +354,12 @@ static unsigned decodeSource(
         assert(!dimension);
     } else if (relativeAddress == IL_ADDR_REG_RELATIVE) {
         src->srcCount = dimension ? 2 : 1;
-        src->srcs = malloc(src->srcCount * sizeof(Source));
+        src->srcs = allocFromTail(arena, src->srcCount * sizeof(Source));
+        if (src->srcs == NULL) {
+            return idx;
+        }
         for (unsigned i = 0; i < src->srcCount; i++) {
-            idx += decodeSource(&src->srcs[i], &token[idx]);
+            idx += decodeSource(arena, &src->srcs[i], &token[idx]);
         }
     } else {
         assert(false);
@@ -343,6 +379,7 @@ static unsigned decodeSource(
 }
 
 static unsigned decodeInstruction(
+    IlcArena* arena,
     Instruction* instr,
     const Token* token)
 {
@@ -391,41 +428,84 @@ static unsigned decodeInstruction(
     }
 
     instr->dstCount = info->dstCount;
-    instr->dsts = malloc(sizeof(Destination) * instr->dstCount);
-    for (int i = 0; i < instr->dstCount; i++) {
-        idx += decodeDestination(&instr->dsts[i], &token[idx]);
+    instr->dsts = allocFromTail(arena, sizeof(Destination) * instr->dstCount);
+    for (int i = 0; i < instr->dstCount && !arena->failed; i++) {
+        idx += decodeDestination(arena, &instr->dsts[i], &token[idx]);
     }
 
     instr->srcCount = getSourceCount(instr);
-    instr->srcs = malloc(sizeof(Source) * instr->srcCount);
-    for (int i = 0; i < instr->srcCount; i++) {
-        idx += decodeSource(&instr->srcs[i], &token[idx]);
+    instr->srcs = allocFromTail(arena, sizeof(Source) * instr->srcCount);
+    for (int i = 0; i < instr->srcCount && !arena->failed; i++) {
+        idx += decodeSource(arena, &instr->srcs[i], &token[idx]);
     }
 
     instr->extraCount = getExtraCount(instr);
-    instr->extras = malloc(sizeof(Token) * instr->extraCount);
+    instr->extras = allocFromTail(arena, sizeof(Token) * instr->extraCount);
+    if (arena->failed) {
+        return idx;
+    }
     memcpy(instr->extras, &token[idx], sizeof(Token) * instr->extraCount);
     idx += instr->extraCount;
 
     return idx;
 }
 
+static size_t getArenaSlotSize()
+{
+    size_t size = sizeof(Instruction);
+
+    size = sizeof(Destination) > size ? sizeof(Destination) : size;
+    size = sizeof(Source) > size ? sizeof(Source) : size;
+    return (size + 7) & ~(size_t)7;
+}
+
 Kernel* ilcDecodeStream(
     const Token* tokens,
     unsigned count)
 {
-    Kernel* kernel = malloc(sizeof(Kernel));
+    // Every token decodes into at most one instruction, operand or extra token. Size the
+    // allocation so that the kernel and all of its IR fit in a single block: instructions
+    // are laid out contiguously from the front and operands are allocated from the back.
+    size_t headerSize = (sizeof(Kernel) + 7) & ~(size_t)7;
+    size_t arenaSize = 0;
+    if (count <= (SIZE_MAX - headerSize) / getArenaSlotSize()) {
+        arenaSize = count * getArenaSlotSize();
+    } else {
+        LOGE("IL stream too large (%u tokens)\n", count);
+    }
+
+    uint8_t* base = malloc(headerSize + arenaSize);
+    Kernel* kernel = (Kernel*)base;
+    IlcArena arena = {
+        .head = base + headerSize,
+        .tail = base + headerSize + arenaSize,
+        .failed = false,
+    };
     unsigned idx = 0;
 
     idx += decodeIlLang(kernel, &tokens[idx]);
     idx += decodeIlVersion(kernel, &tokens[idx]);
 
     kernel->instrCount = 0;
-    kernel->instrs = NULL;
+    kernel->instrs = (Instruction*)arena.head;
     while (idx < count) {
+        if ((size_t)(arena.tail - arena.head) < sizeof(Instruction)) {
+            arena.failed = true;
+            break;
+        }
+
+        arena.head += sizeof(Instruction);
         kernel->instrCount++;
-        kernel->instrs = realloc(kernel->instrs, sizeof(Instruction) * kernel->instrCount);
-        idx += decodeInstruction(&kernel->instrs[kernel->instrCount - 1], &tokens[idx]);
+        idx += decodeInstruction(&arena, &kernel->instrs[kernel->instrCount - 1], &tokens[idx]);
+        if (arena.failed) {
+            // Drop the partially decoded instruction
+            kernel->instrCount--;
+            break;
+        }
+    }
+
+    if (arena.failed) {
+        LOGE("malformed IL stream, decoding stopped at token %u of %u\n", idx, count);
     }
 
     return kernel;
@@ -372,6 +372,7 @@ static void dumpSource(
     }
 
     if (src->registerType == IL_REGTYPE_ITEMP ||
+        (src->registerType == IL_REGTYPE_TEMP && srcCount > 0) ||
         src->registerType == IL_REGTYPE_CONST_BUFF ||
         src->registerType == IL_REGTYPE_INPUTCP) {
         assert(srcCount <= 1);
@@ -16,6 +16,27 @@
 #define GET_BIT(dword, bit) \
     (GET_BITS(dword, bit, bit))
 
+#ifdef ILC_COUNT_ALLOCS
+// Benchmark builds count the heap allocations made by the compiler
+extern unsigned long gIlcAllocCount;
+
+#define malloc(size)        (gIlcAllocCount++, malloc(size))
+#define calloc(count, size) (gIlcAllocCount++, calloc(count, size))
+#define realloc(ptr, size)  (gIlcAllocCount++, realloc(ptr, size))
+#endif
+
+// Bump when the generated SPIR-V changes to invalidate shader cache entries
+#define ILC_COMPILER_REVISION   (12)
+
+typedef enum {
+    ILC_OPTION_SSA = 1 << 0, // Keep temporaries in SSA form instead of private variables
+    ILC_OPTION_DEBUG_INFO = 1 << 1, // Emit debug names and source information
+    ILC_OPTION_COLLAPSE_MOVS = 1 << 2, // Forward mov sources to their uses
+    ILC_OPTION_REMOVE_DEAD_TEMPS = 1 << 3, // Remove instructions writing unread temporaries
+    ILC_OPTION_REMOVE_REDUNDANT_DCLS = 1 << 4, // Remove repeated declarations
+    ILC_OPTION_SPECIALIZE_LINK_CONSTS = 1 << 5, // Read static cb indices from spec constants
+} IlcOption;
+
 typedef uint32_t Token;
 typedef struct _Source Source;
 
@@ -86,8 +107,37 @@ void ilcDumpKernel(
     FILE* file,
     const Kernel* kernel);
 
+unsigned ilcGetOptions();
+
+void ilcOptimizeKernel(
+    Kernel* kernel,
+    const char* name);
+
 IlcShader ilcCompileKernel(
     const Kernel* kernel,
     const char* name);
 
+bool ilcCacheIsEnabled();
+
+unsigned ilcCacheSerialize(
+    uint8_t** data,
+    const IlcShader* shader,
+    unsigned ilSize);
+
+bool ilcCacheDeserialize(
+    IlcShader* shader,
+    const uint8_t* data,
+    unsigned size,
+    unsigned ilSize);
+
+bool ilcCacheLoad(
+    IlcShader* shader,
+    const char* name,
+    unsigned ilSize);
+
+void ilcCacheStore(
+    const IlcShader* shader,
+    const char* name,
+    unsigned ilSize);
+
 #endif // AMDILC_INTERNAL_H_
@@ -0,0 +1,575 @@
+#include "amdilc_internal.h"
+
+#define MAX_TRACKED_COPIES  (64)
+
+typedef struct {
+    uint32_t dstNum; // Temporary holding the copy
+    uint8_t srcType;
+    uint32_t srcNum;
+    uint8_t swizzle[4];
+} IlcCopy;
+
+static bool isPureInstruction(
+    const Instruction* instr)
+{
+    // Instructions without side effects besides writing their destinations
+    switch (instr->opcode) {
+    case IL_OP_ABS:
+    case IL_OP_ACOS:
+    case IL_OP_ADD:
+    case IL_OP_ASIN:
+    case IL_OP_ATAN:
+    case IL_OP_DIV:
+    case IL_OP_DP3:
+    case IL_OP_DP4:
+    case IL_OP_DSX:
+    case IL_OP_DSY:
+    case IL_OP_FRC:
+    case IL_OP_MAD:
+    case IL_OP_MAX:
+    case IL_OP_MIN:
+    case IL_OP_MOV:
+    case IL_OP_MUL:
+    case IL_OP_FTOI:
+    case IL_OP_FTOU:
+    case IL_OP_ITOF:
+    case IL_OP_UTOF:
+    case IL_OP_ROUND_NEAR:
+    case IL_OP_ROUND_NEG_INF:
+    case IL_OP_ROUND_PLUS_INF:
+    case IL_OP_ROUND_ZERO:
+    case IL_OP_EXP_VEC:
+    case IL_OP_LOG_VEC:
+    case IL_OP_RSQ_VEC:
+    case IL_OP_SIN_VEC:
+    case IL_OP_COS_VEC:
+    case IL_OP_SQRT_VEC:
+    case IL_OP_DP2:
+    case IL_OP_F_2_F16:
+    case IL_OP_F16_2_F:
+    case IL_OP_EQ:
+    case IL_OP_GE:
+    case IL_OP_LT:
+    case IL_OP_NE:
+    case IL_OP_I_NOT:
+    case IL_OP_I_OR:
+    case IL_OP_I_ADD:
+    case IL_OP_I_MAD:
+    case IL_OP_I_MUL:
+    case IL_OP_I_NEGATE:
+    case IL_OP_I_SHL:
+    case IL_OP_I_SHR:
+    case IL_OP_U_SHR:
+    case IL_OP_U_DIV:
+    case IL_OP_U_MOD:
+    case IL_OP_AND:
+    case IL_OP_U_BIT_EXTRACT:
+    case IL_OP_U_BIT_INSERT:
+    case IL_OP_I_EQ:
+    case IL_OP_I_GE:
+    case IL_OP_I_LT:
+    case IL_OP_I_NE:
+    case IL_OP_U_LT:
+    case IL_OP_U_GE:
+    case IL_OP_CMOV_LOGICAL:
+    case IL_OP_LOAD:
+    case IL_OP_RESINFO:
+    case IL_OP_SAMPLE:
+    case IL_OP_SAMPLE_B:
+    case IL_OP_SAMPLE_G:
+    case IL_OP_SAMPLE_L:
+    case IL_OP_SAMPLE_C_LZ:
+    case IL_OP_LDS_LOAD_VEC:
+    case IL_OP_UAV_LOAD:
+    case IL_OP_SRV_STRUCT_LOAD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isMemoryInstruction(
+    const Instruction* instr)
+{
+    // Instructions with side effects that don't alter the control flow
+    switch (instr->opcode) {
+    case IL_OP_DISCARD_LOGICALZ:
+    case IL_OP_DISCARD_LOGICALNZ:
+    case IL_OP_FENCE:
+    case IL_OP_LDS_STORE_VEC:
+    case IL_OP_UAV_STORE:
+    case IL_OP_UAV_ADD:
+    case IL_OP_UAV_READ_ADD:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isDeclaration(
+    const Instruction* instr)
+{
+    switch (instr->opcode) {
+    case IL_DCL_INDEXED_TEMP_ARRAY:
+    case IL_DCL_CONST_BUFFER:
+    case IL_DCL_LITERAL:
+    case IL_DCL_OUTPUT:
+    case IL_DCL_INPUT:
+    case IL_DCL_RESOURCE:
+    case IL_OP_DCL_NUM_THREAD_PER_GROUP:
+    case IL_OP_DCL_UAV:
+    case IL_OP_DCL_TYPED_UAV:
+    case IL_OP_DCL_RAW_SRV:
+    case IL_OP_DCL_STRUCT_SRV:
+    case IL_DCL_STRUCT_LDS:
+    case IL_DCL_GLOBAL_FLAGS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool isSameSource(
+    const Source* src1,
+    const Source* src2)
+{
+    if (src1->registerNum != src2->registerNum ||
+        src1->registerType != src2->registerType ||
+        memcmp(src1->swizzle, src2->swizzle, sizeof(src1->swizzle)) != 0 ||
+        memcmp(src1->negate, src2->negate, sizeof(src1->negate)) != 0 ||
+        src1->invert != src2->invert ||
+        src1->bias != src2->bias ||
+        src1->x2 != src2->x2 ||
+        src1->sign != src2->sign ||
+        src1->abs != src2->abs ||
+        src1->divComp != src2->divComp ||
+        src1->clamp != src2->clamp ||
+        src1->srcCount != src2->srcCount ||
+        src1->hasImmediate != src2->hasImmediate ||
+        (src1->hasImmediate && src1->immediate != src2->immediate)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < src1->srcCount; i++) {
+        if (!isSameSource(&src1->srcs[i], &src2->srcs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isSameDestination(
+    const Destination* dst1,
+    const Destination* dst2)
+{
+    if (dst1->registerNum != dst2->registerNum ||
+        dst1->registerType != dst2->registerType ||
+        memcmp(dst1->component, dst2->component, sizeof(dst1->component)) != 0 ||
+        dst1->clamp != dst2->clamp ||
+        dst1->shiftScale != dst2->shiftScale ||
+        (dst1->absoluteSrc == NULL) != (dst2->absoluteSrc == NULL) ||
+        (dst1->absoluteSrc != NULL && !isSameSource(dst1->absoluteSrc, dst2->absoluteSrc)) ||
+        dst1->relativeSrcCount != dst2->relativeSrcCount ||
+        dst1->hasImmediate != dst2->hasImmediate ||
+        (dst1->hasImmediate && dst1->immediate != dst2->immediate)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < dst1->relativeSrcCount; i++) {
+        if (!isSameSource(&dst1->relativeSrcs[i], &dst2->relativeSrcs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isSameInstruction(
+    const Instruction* instr1,
+    const Instruction* instr2)
+{
+    if (instr1->opcode != instr2->opcode ||
+        instr1->control != instr2->control ||
+        instr1->primModifier != instr2->primModifier ||
+        instr1->secModifier != instr2->secModifier ||
+        instr1->resourceFormat != instr2->resourceFormat ||
+        instr1->addressOffset != instr2->addressOffset ||
+        instr1->dstCount != instr2->dstCount ||
+        instr1->srcCount != instr2->srcCount ||
+        instr1->extraCount != instr2->extraCount ||
+        (instr1->extraCount > 0 &&
+         memcmp(instr1->extras, instr2->extras, instr1->extraCount * sizeof(Token)) != 0)) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < instr1->dstCount; i++) {
+        if (!isSameDestination(&instr1->dsts[i], &instr2->dsts[i])) {
+            return false;
+        }
+    }
+    for (unsigned i = 0; i < instr1->srcCount; i++) {
+        if (!isSameSource(&instr1->srcs[i], &instr2->srcs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static bool isPlainSource(
+    const Source* src)
+{
+    // Only a swizzle is applied
+    return !src->negate[0] && !src->negate[1] && !src->negate[2] && !src->negate[3] &&
+           !src->invert && !src->bias && !src->x2 && !src->sign && !src->abs &&
+           src->divComp == IL_DIVCOMP_NONE && !src->clamp && src->srcCount == 0 &&
+           !src->hasImmediate;
+}
+
+static bool isPlainTempDestination(
+    const Destination* dst)
+{
+    return dst->registerType == IL_REGTYPE_TEMP && dst->absoluteSrc == NULL &&
+           dst->relativeSrcCount == 0 && !dst->hasImmediate;
+}
+
+static bool isCopy(
+    const Instruction* instr)
+{
+    if (instr->opcode != IL_OP_MOV || instr->primModifier != 0 || instr->secModifier != 0) {
+        return false;
+    }
+
+    const Destination* dst = &instr->dsts[0];
+    const Source* src = &instr->srcs[0];
+
+    // Literals are never written to and can be forwarded as well
+    return isPlainTempDestination(dst) && !dst->clamp && dst->shiftScale == IL_SHIFT_NONE &&
+           dst->component[0] == IL_MODCOMP_WRITE && dst->component[1] == IL_MODCOMP_WRITE &&
+           dst->component[2] == IL_MODCOMP_WRITE && dst->component[3] == IL_MODCOMP_WRITE &&
+           (src->registerType == IL_REGTYPE_TEMP || src->registerType == IL_REGTYPE_LITERAL) &&
+           !(src->registerType == IL_REGTYPE_TEMP && src->registerNum == dst->registerNum) &&
+           isPlainSource(src);
+}
+
+static unsigned removeInstructions(
+    Kernel* kernel,
+    const bool* isRemoved)
+{
+    unsigned instrCount = 0;
+
+    // Instructions only point into the kernel allocation, moving them around is fine
+    for (unsigned i = 0; i < kernel->instrCount; i++) {
+        if (!isRemoved[i]) {
+            kernel->instrs[instrCount] = kernel->instrs[i];
+            instrCount++;
+        }
+    }
+
+    unsigned removedCount = kernel->instrCount - instrCount;
+    kernel->instrCount = instrCount;
+    return removedCount;
+}
+
+static bool getTempCount(
+    unsigned* tempCount,
+    const Source* src)
+{
+    if (src->registerType == IL_REGTYPE_TEMP) {
+        if (src->srcCount > 0) {
+            // Relatively addressed temporary, any of them could be read
+            return false;
+        }
+        if (src->registerNum >= *tempCount) {
+            *tempCount = src->registerNum + 1;
+        }
+    }
+
+    for (unsigned i = 0; i < src->srcCount; i++) {
+        if (!getTempCount(tempCount, &src->srcs[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void countTempReads(
+    unsigned* readCounts,
+    const Source* src,
+    int increment)
+{
+    if (src->registerType == IL_REGTYPE_TEMP) {
+        readCounts[src->registerNum] += increment;
+    }
+
+    for (unsigned i = 0; i < src->srcCount; i++) {
+        countTempReads(readCounts, &src->srcs[i], increment);
+    }
+}
+
+static void countInstructionTempReads(
+    unsigned* readCounts,
+    const Instruction* instr,
+    int increment)
+{
+    for (unsigned i = 0; i < instr->dstCount; i++) {
+        const Destination* dst = &instr->dsts[i];
+
+        if (dst->absoluteSrc != NULL) {
+            countTempReads(readCounts, dst->absoluteSrc, increment);
+        }
+        for (unsigned j = 0; j < dst->relativeSrcCount; j++) {
+            countTempReads(readCounts, &dst->relativeSrcs[j], increment);
+        }
+    }
+    for (unsigned i = 0; i < instr->srcCount; i++) {
+        countTempReads(readCounts, &instr->srcs[i], increment);
+    }
+}
+
+static bool isUnreadWrite(
+    const Instruction* instr,
+    const unsigned* readCounts,
+    bool movsOnly)
+{
+    if (movsOnly ? instr->opcode != IL_OP_MOV : !isPureInstruction(instr)) {
+        return false;
+    }
+    if (instr->dstCount == 0) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < instr->dstCount; i++) {
+        const Destination* dst = &instr->dsts[i];
+
+        if (!isPlainTempDestination(dst) || readCounts[dst->registerNum] > 0) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static unsigned removeUnreadWrites(
+    Kernel* kernel,
+    bool movsOnly)
+{
+    unsigned tempCount = 0;
+
+    for (unsigned i = 0; i < kernel->instrCount; i++) {
+        const Instruction* instr = &kernel->instrs[i];
+
+        for (unsigned j = 0; j < instr->dstCount; j++) {
+            const Destination* dst = &instr->dsts[j];
+
+            if (dst->registerType == IL_REGTYPE_TEMP && dst->registerNum >= tempCount) {
+                tempCount = dst->registerNum + 1;
+            }
+            if (dst->absoluteSrc != NULL && !getTempCount(&tempCount, dst->absoluteSrc)) {
+                return 0;
+            }
+            for (unsigned k = 0; k < dst->relativeSrcCount; k++) {
+                if (!getTempCount(&tempCount, &dst->relativeSrcs[k])) {
+                    return 0;
+                }
+            }
+        }
+        for (unsigned j = 0; j < instr->srcCount; j++) {
+            if (!getTempCount(&tempCount, &instr->srcs[j])) {
+                return 0;
+            }
+        }
+    }
+
+    unsigned* readCounts = calloc(tempCount, sizeof(unsigned));
+    bool* isRemoved = calloc(kernel->instrCount, sizeof(bool));
+
+    for (unsigned i = 0; i < kernel->instrCount; i++) {
+        countInstructionTempReads(readCounts, &kernel->instrs[i], 1);
+    }
+
+    // Walk backwards so that whole chains of unread writes go away in one sweep,
+    // sweep again for writes only read by removed instructions placed after them in loops
+    bool hasRemoved;
+    do {
+        hasRemoved = false;
+
+        for (int i = kernel->instrCount - 1; i >= 0; i--) {
+            const Instruction* instr = &kernel->instrs[i];
+
+            if (!isRemoved[i] && isUnreadWrite(instr, readCounts, movsOnly)) {
+                countInstructionTempReads(readCounts, instr, -1);
+                isRemoved[i] = true;
+                hasRemoved = true;
+            }
+        }
+    } while (hasRemoved);
+
+    unsigned removedCount = removeInstructions(kernel, isRemoved);
+
+    free(readCounts);
+    free(isRemoved);
+    return removedCount;
+}
+
+static void invalidateCopies(
+    IlcCopy* copies,
+    unsigned* copyCount,
+    const Destination* dst)
+{
+    if (dst->registerType != IL_REGTYPE_TEMP) {
+        return;
+    }
+    if (!isPlainTempDestination(dst)) {
+        *copyCount = 0;
+        return;
+    }
+
+    unsigned count = 0;
+    for (unsigned i = 0; i < *copyCount; i++) {
+        const IlcCopy* copy = &copies[i];
+
+        if (copy->dstNum != dst->registerNum &&
+            !(copy->srcType == IL_REGTYPE_TEMP && copy->srcNum == dst->registerNum)) {
+            copies[count] = *copy;
+            count++;
+        }
+    }
+
+    *copyCount = count;
+}
+
+static bool forwardCopy(
+    Source* src,
+    const IlcCopy* copies,
+    unsigned copyCount)
+{
+    if (src->registerType != IL_REGTYPE_TEMP || src->srcCount > 0 || src->hasImmediate) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < copyCount; i++) {
+        const IlcCopy* copy = &copies[i];
+
+        if (copy->dstNum != src->registerNum) {
+            continue;
+        }
+
+        // Compose the swizzles, modifiers apply to the result and stay unchanged
+        src->registerType = copy->srcType;
+        src->registerNum = copy->srcNum;
+        for (unsigned j = 0; j < 4; j++) {
+            if (src->swizzle[j] <= IL_COMPSEL_W_A) {
+                src->swizzle[j] = copy->swizzle[src->swizzle[j]];
+            }
+        }
+        return true;
+    }
+
+    return false;
+}
+
+static unsigned collapseMovChains(
+    Kernel* kernel)
+{
+    IlcCopy copies[MAX_TRACKED_COPIES];
+    unsigned copyCount = 0;
+    unsigned forwardCount = 0;
+
+    for (unsigned i = 0; i < kernel->instrCount; i++) {
+        Instruction* instr = &kernel->instrs[i];
+
+        if (!isPureInstruction(instr) && !isMemoryInstruction(instr)) {
+            // Don't track copies across control flow
+            copyCount = 0;
+            continue;
+        }
+
+        for (unsigned j = 0; j < instr->srcCount; j++) {
+            if (forwardCopy(&instr->srcs[j], copies, copyCount)) {
+                forwardCount++;
+            }
+        }
+        for (unsigned j = 0; j < instr->dstCount; j++) {
+            invalidateCopies(copies, &copyCount, &instr->dsts[j]);
+        }
+
+        if (isCopy(instr)) {
+            if (copyCount == MAX_TRACKED_COPIES) {
+                // Evict the oldest copy
+                memmove(&copies[0], &copies[1], (MAX_TRACKED_COPIES - 1) * sizeof(IlcCopy));
+                copyCount--;
+            }
+
+            const Source* src = &instr->srcs[0];
+            IlcCopy* copy = &copies[copyCount];
+            *copy = (IlcCopy) {
+                .dstNum = instr->dsts[0].registerNum,
+                .srcType = src->registerType,
+                .srcNum = src->registerNum,
+                .swizzle = { 0 }, // Initialized below
+            };
+            memcpy(copy->swizzle, src->swizzle, sizeof(copy->swizzle));
+            copyCount++;
+        }
+    }
+
+    LOGT("forwarded %u sources\n", forwardCount);
+
+    // Drop the moves whose results are no longer read
+    return removeUnreadWrites(kernel, true);
+}
+
+static unsigned removeDeadTemps(
+    Kernel* kernel)
+{
+    return removeUnreadWrites(kernel, false);
+}
+
+static unsigned removeRedundantDcls(
+    Kernel* kernel)
+{
+    bool* isRemoved = calloc(kernel->instrCount, sizeof(bool));
+
+    for (unsigned i = 0; i < kernel->instrCount; i++) {
+        const Instruction* instr = &kernel->instrs[i];
+
+        if (!isDeclaration(instr)) {
+            continue;
+        }
+
+        for (unsigned j = 0; j < i; j++) {
+            if (!isRemoved[j] && isSameInstruction(&kernel->instrs[j], instr)) {
+                isRemoved[i] = true;
+                break;
+            }
+        }
+    }
+
+    unsigned removedCount = removeInstructions(kernel, isRemoved);
+
+    free(isRemoved);
+    return removedCount;
+}
+
+void ilcOptimizeKernel(
+    Kernel* kernel,
+    const char* name)
+{
+    unsigned options = ilcGetOptions();
+
+    if (options & ILC_OPTION_REMOVE_REDUNDANT_DCLS) {
+        unsigned removedCount = removeRedundantDcls(kernel);
+        LOGV("%s: removed %u redundant declarations\n", name, removedCount);
+    }
+    if (options & ILC_OPTION_COLLAPSE_MOVS) {
+        unsigned removedCount = collapseMovChains(kernel);
+        LOGV("%s: removed %u collapsed moves\n", name, removedCount);
+    }
+    if (options & ILC_OPTION_REMOVE_DEAD_TEMPS) {
+        unsigned removedCount = removeDeadTemps(kernel);
+        LOGV("%s: removed %u instructions writing unread temporaries\n", name, removedCount);
+    }
+}
@@ -1,7 +1,10 @@
+#include <math.h>
 #include "amdilc_internal.h"
 #include "amdilc_spirv.h"
 
-#define BUFFER_ALLOC_THRESHOLD 64
+#define BUFFER_INITIAL_CAPACITY     64
+#define HEADER_WORD_COUNT           5
+#define DEFINITION_INITIAL_COUNT    1024
 
 static unsigned strlenw(
     const char* str)
@@ -10,16 +13,29 @@ static unsigned strlenw(
     return (strlen(str) + 4) / sizeof(IlcSpvWord);
 }
 
-static void putWord(
+static void reserveWords(
     IlcSpvBuffer* buffer,
-    IlcSpvWord word)
+    unsigned count)
 {
-    // Check if we need to resize the buffer
-    if (buffer->wordCount % BUFFER_ALLOC_THRESHOLD == 0) {
-        size_t size = sizeof(IlcSpvWord) * (buffer->wordCount + BUFFER_ALLOC_THRESHOLD);
-        buffer->words = realloc(buffer->words, size);
+    unsigned requiredCapacity = buffer->wordCount + count;
+
+    if (requiredCapacity <= buffer->wordCapacity) {
+        return;
     }
 
+    // Grow geometrically to keep appends amortized constant time
+    unsigned newCapacity = buffer->wordCapacity == 0 ? BUFFER_INITIAL_CAPACITY
+                                                     : 2 * buffer->wordCapacity;
+    newCapacity = newCapacity > requiredCapacity ? newCapacity : requiredCapacity;
+    buffer->words = realloc(buffer->words, sizeof(IlcSpvWord) * newCapacity);
+    buffer->wordCapacity = newCapacity;
+}
+
+static void putWord(
+    IlcSpvBuffer* buffer,
+    IlcSpvWord word)
+{
+    reserveWords(buffer, 1);
     buffer->words[buffer->wordCount++] = word;
 }
 
@@ -54,9 +70,14 @@ static void putBuffer(
     IlcSpvBuffer* buffer,
     IlcSpvBuffer* otherBuffer)
 {
-    for (unsigned i = 0; i < otherBuffer->wordCount; i++) {
-        putWord(buffer, otherBuffer->words[i]);
+    if (otherBuffer->wordCount == 0) {
+        return;
     }
+
+    reserveWords(buffer, otherBuffer->wordCount);
+    memcpy(&buffer->words[buffer->wordCount], otherBuffer->words,
+           sizeof(IlcSpvWord) * otherBuffer->wordCount);
+    buffer->wordCount += otherBuffer->wordCount;
 }
 
 static void putHeader(
@@ -71,47 +92,212 @@ static void putHeader(
     putWord(buffer, 0);
 }
 
-static IlcSpvId putType(
+static void setDefinition(
+    IlcSpvModule* module,
+    IlcSpvId id,
+    IlcSpvBufferId bufferId,
+    unsigned offset)
+{
+    if (id >= module->definitionCount) {
+        unsigned newCount = module->definitionCount == 0 ? DEFINITION_INITIAL_COUNT
+                                                         : 2 * module->definitionCount;
+        newCount = newCount > id ? newCount : id + 1;
+        module->definitions = realloc(module->definitions, sizeof(IlcSpvDefinition) * newCount);
+        memset(&module->definitions[module->definitionCount], 0,
+               sizeof(IlcSpvDefinition) * (newCount - module->definitionCount));
+        module->definitionCount = newCount;
+    }
+
+    module->definitions[id] = (IlcSpvDefinition) {
+        .bufferId = bufferId,
+        .offset = offset,
+    };
+}
+
+static const IlcSpvWord* getDefinition(
+    const IlcSpvModule* module,
+    IlcSpvId id)
+{
+    // Returned pointer is only valid until the next instruction is added
+    if (id >= module->definitionCount || module->definitions[id].bufferId == ID_MAIN) {
+        return NULL;
+    }
+
+    const IlcSpvDefinition* definition = &module->definitions[id];
+    return &module->buffer[definition->bufferId].words[definition->offset];
+}
+
+static IlcSpvId putValueInstr(
+    IlcSpvModule* module,
+    uint16_t op,
+    uint16_t wordCount,
+    IlcSpvId resultTypeId,
+    IlcSpvId resultId)
+{
+    IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+
+    // Keep track of the instruction so that its users can be folded
+    IlcSpvId id = resultId != 0 ? resultId : ilcSpvAllocId(module);
+    setDefinition(module, id, ID_CODE, buffer->wordCount);
+    putInstr(buffer, op, wordCount);
+    putWord(buffer, resultTypeId);
+    putWord(buffer, id);
+    return id;
+}
+
+static uint32_t hashWords(
+    uint32_t hash,
+    unsigned wordCount,
+    const IlcSpvWord* words)
+{
+    // FNV-1a
+    for (unsigned i = 0; i < wordCount; i++) {
+        hash = (hash ^ words[i]) * 16777619;
+    }
+
+    return hash;
+}
+
+static uint32_t hashInstr(
+    IlcSpvBufferId bufferId,
+    IlcSpvWord opWord,
+    IlcSpvId resultTypeId,
+    unsigned argCount,
+    const IlcSpvWord* args)
+{
+    const IlcSpvWord header[] = { bufferId, opWord, resultTypeId };
+
+    return hashWords(hashWords(2166136261, 3, header), argCount, args);
+}
+
+static unsigned getArgOffset(
+    IlcSpvBufferId bufferId)
+{
+    // Constants carry a result type before the result ID
+    return bufferId == ID_CONSTANTS ? 3 : 2;
+}
+
+static bool matchInstr(
+    const IlcSpvModule* module,
+    const IlcSpvHashEntry* entry,
+    IlcSpvBufferId bufferId,
+    IlcSpvWord opWord,
+    IlcSpvId resultTypeId,
+    const IlcSpvWord* args)
+{
+    if (entry->bufferId != bufferId) {
+        return false;
+    }
+
+    const IlcSpvWord* words = &module->buffer[bufferId].words[entry->offset];
+    unsigned argOffset = getArgOffset(bufferId);
+    unsigned argCount = (opWord >> SpvWordCountShift) - argOffset;
+
+    if (words[0] != opWord) {
+        return false;
+    }
+    if (bufferId == ID_CONSTANTS && words[1] != resultTypeId) {
+        return false;
+    }
+
+    for (unsigned i = 0; i < argCount; i++) {
+        if (words[argOffset + i] != args[i]) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static IlcSpvHashEntry* findHashEntry(
+    IlcSpvModule* module,
+    IlcSpvBufferId bufferId,
+    IlcSpvWord opWord,
+    IlcSpvId resultTypeId,
+    const IlcSpvWord* args,
+    uint32_t hash)
+{
+    // Linear probing, capacity is a power of two
+    unsigned mask = module->hashCapacity - 1;
+
+    for (unsigned i = hash & mask;; i = (i + 1) & mask) {
+        IlcSpvHashEntry* entry = &module->hashEntries[i];
+
+        if (entry->bufferId == ID_MAIN ||
+            (entry->hash == hash &&
+             matchInstr(module, entry, bufferId, opWord, resultTypeId, args))) {
+            return entry;
+        }
+    }
+}
+
+static void growHashTable(
+    IlcSpvModule* module)
+{
+    unsigned oldCapacity = module->hashCapacity;
+    IlcSpvHashEntry* oldEntries = module->hashEntries;
+
+    module->hashCapacity = oldCapacity == 0 ? 256 : 2 * oldCapacity;
+    module->hashEntries = calloc(module->hashCapacity, sizeof(IlcSpvHashEntry));
+
+    // Entries are unique, reinsert them without comparing
+    unsigned mask = module->hashCapacity - 1;
+    for (unsigned i = 0; i < oldCapacity; i++) {
+        const IlcSpvHashEntry* oldEntry = &oldEntries[i];
+
+        if (oldEntry->bufferId != ID_MAIN) {
+            unsigned j = oldEntry->hash & mask;
+            while (module->hashEntries[j].bufferId != ID_MAIN) {
+                j = (j + 1) & mask;
+            }
+            module->hashEntries[j] = *oldEntry;
+        }
+    }
+
+    free(oldEntries);
+}
+
+static IlcSpvId putHashedInstr(
     IlcSpvModule* module,
+    IlcSpvBufferId bufferId,
     SpvOp op,
+    IlcSpvId resultTypeId,
     unsigned argCount,
     const IlcSpvWord* args,
-    bool hasConstants,
     bool unique)
 {
-    IlcSpvBuffer* buffer = &module->buffer[hasConstants ? ID_TYPES_WITH_CONSTANTS : ID_TYPES];
-
-    if (!unique) {
-        // Check if the type is already present
-        for (int i = 0; i < buffer->wordCount;) {
-            SpvOp typeOp = buffer->words[i] & SpvOpCodeMask;
-            unsigned typeWordCount = buffer->words[i] >> SpvWordCountShift;
-            unsigned typeArgCount = typeWordCount - 2;
-
-            // Got a potential match
-            if (op == typeOp && argCount == typeArgCount) {
-                bool match = true;
-                IlcSpvId typeId = buffer->words[i + 1];
-
-                // Check that the args also match
-                for (unsigned j = 0; j < typeArgCount; j++) {
-                    if (args[j] != buffer->words[i + 2 + j]) {
-                        match = false;
-                        break;
-                    }
-                }
+    IlcSpvBuffer* buffer = &module->buffer[bufferId];
+    unsigned argOffset = getArgOffset(bufferId);
+    IlcSpvWord opWord = op | ((argOffset + argCount) << SpvWordCountShift);
+    uint32_t hash = hashInstr(bufferId, opWord, resultTypeId, argCount, args);
 
-                if (match) {
-                    return typeId;
-                }
-            }
+    // Keep the load factor under 1/2
+    if (2 * (module->hashEntryCount + 1) > module->hashCapacity) {
+        growHashTable(module);
+    }
 
-            i += typeWordCount;
-        }
+    // Check if the instruction is already present
+    IlcSpvHashEntry* entry = findHashEntry(module, bufferId, opWord, resultTypeId, args, hash);
+    if (entry->bufferId != ID_MAIN && !unique) {
+        return buffer->words[entry->offset + argOffset - 1];
+    }
+
+    // Unique instructions don't replace the first matching instruction
+    if (entry->bufferId == ID_MAIN) {
+        *entry = (IlcSpvHashEntry) {
+            .bufferId = bufferId,
+            .offset = buffer->wordCount,
+            .hash = hash,
+        };
+        module->hashEntryCount++;
     }
 
     IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, op, 2 + argCount);
+    setDefinition(module, id, bufferId, buffer->wordCount);
+    putWord(buffer, opWord);
+    if (bufferId == ID_CONSTANTS) {
+        putWord(buffer, resultTypeId);
+    }
     putWord(buffer, id);
     for (int i = 0; i < argCount; i++) {
         putWord(buffer, args[i]);
@@ -120,6 +306,18 @@ static IlcSpvId putType(
     return id;
 }
 
+static IlcSpvId putType(
+    IlcSpvModule* module,
+    SpvOp op,
+    unsigned argCount,
+    const IlcSpvWord* args,
+    bool hasConstants,
+    bool unique)
+{
+    return putHashedInstr(module, hasConstants ? ID_TYPES_WITH_CONSTANTS : ID_TYPES,
+                          op, 0, argCount, args, unique);
+}
+
 static IlcSpvId putConstant(
     IlcSpvModule* module,
     SpvOp op,
@@ -127,47 +325,416 @@ static IlcSpvId putConstant(
     unsigned argCount,
     const IlcSpvWord* args)
 {
-    IlcSpvBuffer* buffer = &module->buffer[ID_CONSTANTS];
-
-    // Check if the constant is already present
-    for (int i = 0; i < buffer->wordCount;) {
-        SpvOp constantOp = buffer->words[i] & SpvOpCodeMask;
-        unsigned constantWordCount = buffer->words[i] >> SpvWordCountShift;
-        unsigned constantArgCount = constantWordCount - 3;
-        IlcSpvId constantResultTypeId = buffer->words[i + 1];
-
-        // Got a potential match
-        if (op == constantOp &&
-            resultTypeId == constantResultTypeId &&
-            argCount == constantArgCount) {
-            bool match = true;
-            IlcSpvId constantId = buffer->words[i + 2];
-
-            // Check that the args also match
-            for (unsigned j = 0; j < constantArgCount; j++) {
-                if (args[j] != buffer->words[i + 3 + j]) {
-                    match = false;
-                    break;
-                }
-            }
+    return putHashedInstr(module, ID_CONSTANTS, op, resultTypeId, argCount, args, false);
+}
+
+static float wordToFloat(
+    IlcSpvWord word)
+{
+    float value;
+    memcpy(&value, &word, sizeof(value));
+    return value;
+}
+
+static IlcSpvWord floatToWord(
+    float value)
+{
+    IlcSpvWord word;
+    memcpy(&word, &value, sizeof(word));
+    return word;
+}
+
+static IlcSpvId getTypeId(
+    const IlcSpvModule* module,
+    IlcSpvId id)
+{
+    const IlcSpvWord* words = getDefinition(module, id);
+
+    if (words == NULL || module->definitions[id].bufferId == ID_TYPES ||
+        module->definitions[id].bufferId == ID_TYPES_WITH_CONSTANTS) {
+        return 0;
+    }
+
+    return words[1];
+}
+
+static unsigned getComponentInfo(
+    const IlcSpvModule* module,
+    IlcSpvId typeId,
+    IlcSpvId* componentTypeId)
+{
+    // Returns the component count of 32-bit scalar and vector types, 0 for other types
+    const IlcSpvWord* words = getDefinition(module, typeId);
+
+    if (words == NULL) {
+        return 0;
+    }
+
+    switch (words[0] & SpvOpCodeMask) {
+    case SpvOpTypeInt:
+    case SpvOpTypeFloat:
+        *componentTypeId = typeId;
+        return words[2] == 32 ? 1 : 0;
+    case SpvOpTypeVector:
+        *componentTypeId = words[2];
+        return getComponentInfo(module, words[2], componentTypeId) == 1 ? words[3] : 0;
+    }
+
+    return 0;
+}
+
+static unsigned getConstantValues(
+    const IlcSpvModule* module,
+    IlcSpvId id,
+    IlcSpvWord* values)
+{
+    // Returns the component count of scalar and vector constants, 0 for other values
+    const IlcSpvWord* words = getDefinition(module, id);
+
+    if (words == NULL || module->definitions[id].bufferId != ID_CONSTANTS) {
+        return 0;
+    }
+
+    unsigned wordCount = words[0] >> SpvWordCountShift;
+
+    if ((words[0] & SpvOpCodeMask) == SpvOpConstant && wordCount == 4) {
+        values[0] = words[3];
+        return 1;
+    } else if ((words[0] & SpvOpCodeMask) == SpvOpConstantComposite && wordCount <= 3 + 4) {
+        unsigned count = wordCount - 3;
 
-            if (match) {
-                return constantId;
+        for (unsigned i = 0; i < count; i++) {
+            if (getConstantValues(module, words[3 + i], &values[i]) != 1) {
+                return 0;
             }
         }
+        return count;
+    }
+
+    return 0;
+}
+
+static bool isConstantEqual(
+    const IlcSpvModule* module,
+    IlcSpvId id,
+    IlcSpvWord value,
+    IlcSpvWord ignoredBits)
+{
+    IlcSpvWord values[4];
+    unsigned count = getConstantValues(module, id, values);
 
-        i += constantWordCount;
+    for (unsigned i = 0; i < count; i++) {
+        if ((values[i] & ~ignoredBits) != value) {
+            return false;
+        }
     }
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, op, 3 + argCount);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
-    for (int i = 0; i < argCount; i++) {
-        putWord(buffer, args[i]);
+    return count > 0;
+}
+
+static IlcSpvId putConstantValues(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    unsigned count,
+    const IlcSpvWord* values)
+{
+    IlcSpvId componentTypeId = 0;
+
+    if (getComponentInfo(module, resultTypeId, &componentTypeId) != count) {
+        return 0;
     }
 
-    return id;
+    if (count == 1) {
+        return ilcSpvPutConstant(module, resultTypeId, values[0]);
+    }
+
+    IlcSpvId consistuentIds[4];
+    for (unsigned i = 0; i < count; i++) {
+        consistuentIds[i] = ilcSpvPutConstant(module, componentTypeId, values[i]);
+    }
+
+    return ilcSpvPutConstantComposite(module, resultTypeId, count, consistuentIds);
+}
+
+static bool foldAluComponent(
+    IlcSpvWord* result,
+    SpvOp op,
+    const IlcSpvWord* args)
+{
+    float a = wordToFloat(args[0]);
+    float b = wordToFloat(args[1]);
+    uint32_t ua = args[0];
+    uint32_t ub = args[1];
+
+    switch (op) {
+    case SpvOpFNegate:
+        *result = ua ^ 0x80000000;
+        return true;
+    case SpvOpFAdd:
+        *result = floatToWord(a + b);
+        return true;
+    case SpvOpFSub:
+        *result = floatToWord(a - b);
+        return true;
+    case SpvOpFMul:
+        *result = floatToWord(a * b);
+        return true;
+    case SpvOpFDiv:
+        // Leave division by zero to the driver
+        if (b == 0.f) {
+            return false;
+        }
+        *result = floatToWord(a / b);
+        return true;
+    case SpvOpSNegate:
+        *result = 0 - ua;
+        return true;
+    case SpvOpIAdd:
+        *result = ua + ub;
+        return true;
+    case SpvOpISub:
+        *result = ua - ub;
+        return true;
+    case SpvOpIMul:
+        *result = ua * ub;
+        return true;
+    case SpvOpUDiv:
+    case SpvOpUMod:
+        if (ub == 0) {
+            return false;
+        }
+        *result = op == SpvOpUDiv ? ua / ub : ua % ub;
+        return true;
+    case SpvOpNot:
+        *result = ~ua;
+        return true;
+    case SpvOpBitwiseAnd:
+        *result = ua & ub;
+        return true;
+    case SpvOpBitwiseOr:
+        *result = ua | ub;
+        return true;
+    case SpvOpBitwiseXor:
+        *result = ua ^ ub;
+        return true;
+    case SpvOpShiftLeftLogical:
+    case SpvOpShiftRightLogical:
+    case SpvOpShiftRightArithmetic:
+        // Undefined for shift amounts >= 32
+        if (ub >= 32) {
+            return false;
+        }
+        if (op == SpvOpShiftLeftLogical) {
+            *result = ua << ub;
+        } else if (op == SpvOpShiftRightLogical) {
+            *result = ua >> ub;
+        } else {
+            *result = (ua >> ub) | ((ua & 0x80000000) && ub > 0 ? ~(0xFFFFFFFF >> ub) : 0);
+        }
+        return true;
+    case SpvOpConvertFToS:
+        // Undefined for out of range values
+        if (!(a >= -2147483648.f && a < 2147483648.f)) {
+            return false;
+        }
+        *result = (int32_t)a;
+        return true;
+    case SpvOpConvertFToU:
+        if (!(a >= 0.f && a < 4294967296.f)) {
+            return false;
+        }
+        *result = (uint32_t)a;
+        return true;
+    case SpvOpConvertSToF:
+        *result = floatToWord((float)(int32_t)ua);
+        return true;
+    case SpvOpConvertUToF:
+        *result = floatToWord((float)ua);
+        return true;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static bool foldGLSLComponent(
+    IlcSpvWord* result,
+    enum GLSLstd450 glslOp,
+    const IlcSpvWord* args)
+{
+    // Only exact operations are folded, transcendentals are left to the driver
+    float a = wordToFloat(args[0]);
+    float b = wordToFloat(args[1]);
+    float c = wordToFloat(args[2]);
+
+    switch (glslOp) {
+    case GLSLstd450FAbs:
+        *result = args[0] & ~0x80000000;
+        return true;
+    case GLSLstd450Floor:
+        *result = floatToWord(floorf(a));
+        return true;
+    case GLSLstd450Ceil:
+        *result = floatToWord(ceilf(a));
+        return true;
+    case GLSLstd450Trunc:
+        *result = floatToWord(truncf(a));
+        return true;
+    case GLSLstd450Fract:
+        if (isinf(a)) {
+            return false;
+        }
+        *result = floatToWord(a - floorf(a));
+        return true;
+    case GLSLstd450FMin:
+    case GLSLstd450NMin:
+        *result = floatToWord(fminf(a, b));
+        return true;
+    case GLSLstd450FMax:
+    case GLSLstd450NMax:
+        *result = floatToWord(fmaxf(a, b));
+        return true;
+    case GLSLstd450FClamp:
+        *result = floatToWord(fminf(fmaxf(a, b), c));
+        return true;
+    case GLSLstd450Fma:
+        *result = floatToWord(fmaf(a, b, c));
+        return true;
+    default:
+        break;
+    }
+
+    return false;
+}
+
+static IlcSpvId foldConstantOp(
+    IlcSpvModule* module,
+    IlcSpvWord op,
+    bool isGLSLOp,
+    IlcSpvId resultTypeId,
+    unsigned idCount,
+    const IlcSpvId* ids)
+{
+    IlcSpvId componentTypeId = 0;
+    unsigned count = getComponentInfo(module, resultTypeId, &componentTypeId);
+    IlcSpvWord values[3][4];
+
+    if (count == 0 || idCount == 0 || idCount > 3) {
+        return 0;
+    }
+
+    for (unsigned i = 0; i < idCount; i++) {
+        if (getConstantValues(module, ids[i], values[i]) != count) {
+            return 0;
+        }
+    }
+
+    IlcSpvWord results[4];
+    for (unsigned i = 0; i < count; i++) {
+        IlcSpvWord args[3] = { 0, 0, 0 };
+
+        for (unsigned j = 0; j < idCount; j++) {
+            args[j] = values[j][i];
+        }
+
+        if (!(isGLSLOp ? foldGLSLComponent(&results[i], op, args)
+                       : foldAluComponent(&results[i], op, args))) {
+            return 0;
+        }
+    }
+
+    return putConstantValues(module, resultTypeId, count, results);
+}
+
+static IlcSpvId simplifyAlu(
+    IlcSpvModule* module,
+    SpvOp op,
+    IlcSpvId resultTypeId,
+    unsigned idCount,
+    const IlcSpvId* ids)
+{
+    // Integer operands may differ in signedness from the result, check before forwarding them
+    bool isFirstTyped = getTypeId(module, ids[0]) == resultTypeId;
+    bool isSecondTyped = idCount > 1 && getTypeId(module, ids[1]) == resultTypeId;
+
+    switch (op) {
+    case SpvOpFNegate:
+    case SpvOpSNegate:
+    case SpvOpNot: {
+        // -(-x) = x, ~(~x) = x
+        const IlcSpvWord* words = getDefinition(module, ids[0]);
+        if (words != NULL && module->definitions[ids[0]].bufferId == ID_CODE &&
+            (words[0] & SpvOpCodeMask) == op && getTypeId(module, words[3]) == resultTypeId) {
+            return words[3];
+        }
+    }   break;
+    case SpvOpFAdd:
+        // x + 0 = x, sign of zero results aren't preserved
+        if (isConstantEqual(module, ids[1], 0, 0x80000000)) {
+            return ids[0];
+        } else if (isConstantEqual(module, ids[0], 0, 0x80000000)) {
+            return ids[1];
+        }
+        break;
+    case SpvOpFSub:
+        if (isConstantEqual(module, ids[1], 0, 0x80000000)) {
+            return ids[0];
+        }
+        break;
+    case SpvOpFMul:
+        if (isConstantEqual(module, ids[1], floatToWord(1.f), 0)) {
+            return ids[0];
+        } else if (isConstantEqual(module, ids[0], floatToWord(1.f), 0)) {
+            return ids[1];
+        }
+        break;
+    case SpvOpFDiv:
+        if (isConstantEqual(module, ids[1], floatToWord(1.f), 0)) {
+            return ids[0];
+        }
+        break;
+    case SpvOpIAdd:
+    case SpvOpBitwiseOr:
+    case SpvOpBitwiseXor:
+        if (isFirstTyped && isConstantEqual(module, ids[1], 0, 0)) {
+            return ids[0];
+        } else if (isSecondTyped && isConstantEqual(module, ids[0], 0, 0)) {
+            return ids[1];
+        }
+        break;
+    case SpvOpISub:
+    case SpvOpShiftLeftLogical:
+    case SpvOpShiftRightLogical:
+    case SpvOpShiftRightArithmetic:
+        if (isFirstTyped && isConstantEqual(module, ids[1], 0, 0)) {
+            return ids[0];
+        }
+        break;
+    case SpvOpIMul:
+        if (isFirstTyped && isConstantEqual(module, ids[1], 1, 0)) {
+            return ids[0];
+        } else if (isSecondTyped && isConstantEqual(module, ids[0], 1, 0)) {
+            return ids[1];
+        }
+        break;
+    case SpvOpUDiv:
+        if (isFirstTyped && isConstantEqual(module, ids[1], 1, 0)) {
+            return ids[0];
+        }
+        break;
+    case SpvOpBitwiseAnd:
+        if (isFirstTyped && isConstantEqual(module, ids[1], 0xFFFFFFFF, 0)) {
+            return ids[0];
+        } else if (isSecondTyped && isConstantEqual(module, ids[0], 0xFFFFFFFF, 0)) {
+            return ids[1];
+        }
+        break;
+    default:
+        break;
+    }
+
+    return 0;
 }
 
 static void putExtInstImport(
@@ -200,8 +767,13 @@ void ilcSpvInit(
     module->currentId = 1;
     module->glsl450ImportId = ilcSpvAllocId(module);
     for (int i = 0; i < ID_MAX; i++) {
-        module->buffer[i] = (IlcSpvBuffer) { 0, NULL };
+        module->buffer[i] = (IlcSpvBuffer) { 0, 0, NULL };
     }
+    module->hashEntryCount = 0;
+    module->hashCapacity = 0;
+    module->hashEntries = NULL;
+    module->definitionCount = 0;
+    module->definitions = NULL;
 
     ilcSpvPutCapability(module, SpvCapabilityShader);
     putExtInstImport(module, module->glsl450ImportId, "GLSL.std.450");
@@ -211,13 +783,23 @@ void ilcSpvInit(
 void ilcSpvFinish(
     IlcSpvModule* module)
 {
+    // Allocate the whole module at once, then merge buffers into it
+    unsigned wordCount = HEADER_WORD_COUNT;
+    for (int i = ID_MAIN + 1; i < ID_MAX; i++) {
+        wordCount += module->buffer[i].wordCount;
+    }
+
+    assert(module->buffer[ID_MAIN].wordCount == 0);
+    reserveWords(&module->buffer[ID_MAIN], wordCount);
     putHeader(module);
 
-    // Merge buffers into one
     for (int i = ID_MAIN + 1; i < ID_MAX; i++) {
         putBuffer(&module->buffer[ID_MAIN], &module->buffer[i]);
         free(module->buffer[i].words);
     }
+
+    free(module->hashEntries);
+    free(module->definitions);
 }
 
 uint32_t ilcSpvAllocId(
@@ -226,6 +808,21 @@ uint32_t ilcSpvAllocId(
     return module->currentId++;
 }
 
+bool ilcSpvGetScalarConstant(
+    const IlcSpvModule* module,
+    IlcSpvId id,
+    IlcSpvWord* value)
+{
+    IlcSpvWord values[4];
+
+    if (getConstantValues(module, id, values) != 1) {
+        return false;
+    }
+
+    *value = values[0];
+    return true;
+}
+
 void ilcSpvPutExtension(
     IlcSpvModule* module,
     const char* name)
@@ -404,11 +1001,12 @@ IlcSpvId ilcSpvPutSampledImageType(
 IlcSpvId ilcSpvPutArrayType(
     IlcSpvModule* module,
     IlcSpvId typeId,
-    IlcSpvId lengthId)
+    IlcSpvId lengthId,
+    bool unique)
 {
     const IlcSpvWord args[] = { typeId, lengthId };
 
-    return putType(module, SpvOpTypeArray, 2, args, true, false);
+    return putType(module, SpvOpTypeArray, 2, args, true, unique);
 }
 
 IlcSpvId ilcSpvPutRuntimeArrayType(
@@ -473,6 +1071,34 @@ IlcSpvId ilcSpvPutConstantComposite(
                        consistuentCount, consistuents);
 }
 
+IlcSpvId ilcSpvPutSpecConstant(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    IlcSpvWord literal)
+{
+    // Specialization constants are told apart by their SpecId decoration
+    return putHashedInstr(module, ID_CONSTANTS, SpvOpSpecConstant, resultTypeId, 1, &literal,
+                          true);
+}
+
+IlcSpvId ilcSpvPutSpecConstantFalse(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId)
+{
+    return putHashedInstr(module, ID_CONSTANTS, SpvOpSpecConstantFalse, resultTypeId, 0, NULL,
+                          true);
+}
+
+IlcSpvId ilcSpvPutSpecConstantComposite(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    unsigned consistuentCount,
+    const IlcSpvId* consistuents)
+{
+    return putConstant(module, SpvOpSpecConstantComposite, resultTypeId,
+                       consistuentCount, consistuents);
+}
+
 void ilcSpvPutFunction(
     IlcSpvModule* module,
     IlcSpvId resultType,
@@ -538,10 +1164,7 @@ IlcSpvId ilcSpvPutLoad(
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpLoad, 4);
-    putWord(buffer, typeId);
-    putWord(buffer, id);
+    IlcSpvId id = putValueInstr(module, SpvOpLoad, 4, typeId, 0);
     putWord(buffer, pointerId);
     return id;
 }
@@ -623,11 +1246,118 @@ IlcSpvId ilcSpvPutVectorShuffle(
     const IlcSpvWord* components)
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+    IlcSpvWord values[8];
+    IlcSpvId componentTypeId = 0;
+    unsigned vec1Count = getComponentInfo(module, getTypeId(module, vec1Id), &componentTypeId);
+    unsigned vec2Count = getComponentInfo(module, getTypeId(module, vec2Id), &componentTypeId);
+
+    // Merge shuffles of shuffles if they still select from at most two vectors
+    if (vec1Count > 0 && vec2Count > 0 && componentCount <= 4) {
+        IlcSpvId sourceIds[2] = { 0, 0 };
+        unsigned sourceCounts[2] = { 0, 0 };
+        IlcSpvWord sourceComponents[4];
+        bool isMerged = false;
+        bool isMergeable = true;
+
+        for (unsigned i = 0; i < componentCount && isMergeable; i++) {
+            IlcSpvId srcId = components[i] < vec1Count ? vec1Id : vec2Id;
+            IlcSpvWord component = components[i] < vec1Count ? components[i]
+                                                             : components[i] - vec1Count;
+            const IlcSpvWord* words = getDefinition(module, srcId);
+
+            if (components[i] >= vec1Count + vec2Count) {
+                isMergeable = false;
+                break;
+            }
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpVectorShuffle, 5 + componentCount);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+            if (words != NULL && module->definitions[srcId].bufferId == ID_CODE &&
+                (words[0] & SpvOpCodeMask) == SpvOpVectorShuffle) {
+                IlcSpvId innerTypeId = 0;
+                unsigned innerCount = getComponentInfo(module, getTypeId(module, words[3]),
+                                                       &innerTypeId);
+                IlcSpvWord innerComponent = words[5 + component];
+
+                if (innerCount == 0 || innerComponent == 0xFFFFFFFF) {
+                    isMergeable = false;
+                    break;
+                }
+
+                srcId = innerComponent < innerCount ? words[3] : words[4];
+                component = innerComponent < innerCount ? innerComponent
+                                                        : innerComponent - innerCount;
+                isMerged = true;
+            }
+
+            unsigned sourceIndex = 0;
+            while (sourceIndex < 2 && sourceIds[sourceIndex] != 0 &&
+                   sourceIds[sourceIndex] != srcId) {
+                sourceIndex++;
+            }
+            if (sourceIndex == 2) {
+                isMergeable = false;
+                break;
+            }
+            if (sourceIds[sourceIndex] == 0) {
+                IlcSpvId sourceTypeId = 0;
+                sourceIds[sourceIndex] = srcId;
+                sourceCounts[sourceIndex] = getComponentInfo(module, getTypeId(module, srcId),
+                                                             &sourceTypeId);
+                isMergeable = sourceCounts[sourceIndex] > 0;
+            }
+
+            // Second source components are indexed after the first ones, fixed up below
+            sourceComponents[i] = component | (sourceIndex << 16);
+        }
+
+        if (isMerged && isMergeable) {
+            if (sourceIds[1] == 0) {
+                sourceIds[1] = sourceIds[0];
+                sourceCounts[1] = sourceCounts[0];
+            }
+            for (unsigned i = 0; i < componentCount; i++) {
+                unsigned sourceIndex = sourceComponents[i] >> 16;
+                sourceComponents[i] = (sourceComponents[i] & 0xFFFF) +
+                                      (sourceIndex == 1 ? sourceCounts[0] : 0);
+            }
+
+            return ilcSpvPutVectorShuffle(module, resultTypeId, sourceIds[0], sourceIds[1],
+                                          componentCount, sourceComponents);
+        }
+    }
+
+    // Check for identity shuffles
+    bool isVec1Identity = getTypeId(module, vec1Id) == resultTypeId;
+    bool isVec2Identity = getTypeId(module, vec2Id) == resultTypeId;
+    for (unsigned i = 0; i < componentCount; i++) {
+        isVec1Identity = isVec1Identity && components[i] == i;
+        isVec2Identity = isVec2Identity && components[i] == vec1Count + i;
+    }
+    if (isVec1Identity && vec1Count == componentCount) {
+        return vec1Id;
+    } else if (isVec2Identity && vec2Count == componentCount) {
+        return vec2Id;
+    }
+
+    // Fold constant components
+    if (vec1Count > 0 && vec2Count > 0 && componentCount <= 4 &&
+        getConstantValues(module, vec1Id, &values[0]) == vec1Count &&
+        getConstantValues(module, vec2Id, &values[vec1Count]) == vec2Count) {
+        IlcSpvWord resultValues[4];
+        bool isFoldable = true;
+
+        for (unsigned i = 0; i < componentCount; i++) {
+            isFoldable = isFoldable && components[i] < vec1Count + vec2Count;
+            resultValues[i] = isFoldable ? values[components[i]] : 0;
+        }
+
+        IlcSpvId constantId = isFoldable ? putConstantValues(module, resultTypeId,
+                                                             componentCount, resultValues) : 0;
+        if (constantId != 0) {
+            return constantId;
+        }
+    }
+
+    IlcSpvId id = putValueInstr(module, SpvOpVectorShuffle, 5 + componentCount, resultTypeId, 0);
     putWord(buffer, vec1Id);
     putWord(buffer, vec2Id);
     for (int i = 0; i < componentCount; i++) {
@@ -643,11 +1373,25 @@ IlcSpvId ilcSpvPutCompositeConstruct(
     const IlcSpvId* consistuents)
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+    IlcSpvId componentTypeId = 0;
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpCompositeConstruct, 3 + consistuentCount);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+    // Fold vectors made of scalar constants
+    if (getComponentInfo(module, resultTypeId, &componentTypeId) == consistuentCount) {
+        IlcSpvWord value;
+        bool isConstant = true;
+
+        for (unsigned i = 0; i < consistuentCount; i++) {
+            isConstant = isConstant && getConstantValues(module, consistuents[i], &value) == 1;
+        }
+
+        if (isConstant) {
+            return ilcSpvPutConstantComposite(module, resultTypeId, consistuentCount,
+                                              consistuents);
+        }
+    }
+
+    IlcSpvId id = putValueInstr(module, SpvOpCompositeConstruct, 3 + consistuentCount,
+                                resultTypeId, 0);
     for (int i = 0; i < consistuentCount; i++) {
         putWord(buffer, consistuents[i]);
     }
@@ -662,11 +1406,51 @@ IlcSpvId ilcSpvPutCompositeExtract(
     const IlcSpvId* indexes)
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+    const IlcSpvWord* words = getDefinition(module, compositeId);
+
+    // Forward components of constant, constructed and shuffled vectors
+    if (words != NULL && indexCount == 1) {
+        SpvOp op = words[0] & SpvOpCodeMask;
+        unsigned operandCount = (words[0] >> SpvWordCountShift) - 3;
+        IlcSpvId vecTypeId = 0;
+
+        if ((op == SpvOpConstantComposite || op == SpvOpCompositeConstruct) &&
+            indexes[0] < operandCount &&
+            getTypeId(module, words[3 + indexes[0]]) == resultTypeId) {
+            return words[3 + indexes[0]];
+        } else if (op == SpvOpVectorShuffle && indexes[0] < operandCount - 2 &&
+                   module->definitions[compositeId].bufferId == ID_CODE) {
+            unsigned vec1Count = getComponentInfo(module, getTypeId(module, words[3]), &vecTypeId);
+            IlcSpvWord component = words[5 + indexes[0]];
+
+            if (vec1Count > 0 && component != 0xFFFFFFFF) {
+                IlcSpvId vecId = component < vec1Count ? words[3] : words[4];
+                IlcSpvWord index = component < vec1Count ? component : component - vec1Count;
+                return ilcSpvPutCompositeExtract(module, resultTypeId, vecId, 1, &index);
+            }
+        }
+    }
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpCompositeExtract, 4 + indexCount);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+    IlcSpvId id = putValueInstr(module, SpvOpCompositeExtract, 4 + indexCount, resultTypeId, 0);
+    putWord(buffer, compositeId);
+    for (int i = 0; i < indexCount; i++) {
+        putWord(buffer, indexes[i]);
+    }
+    return id;
+}
+
+IlcSpvId ilcSpvPutCompositeInsert(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    IlcSpvId objectId,
+    IlcSpvId compositeId,
+    unsigned indexCount,
+    const IlcSpvId* indexes)
+{
+    IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+
+    IlcSpvId id = putValueInstr(module, SpvOpCompositeInsert, 5 + indexCount, resultTypeId, 0);
+    putWord(buffer, objectId);
     putWord(buffer, compositeId);
     for (int i = 0; i < indexCount; i++) {
         putWord(buffer, indexes[i]);
@@ -822,10 +1606,16 @@ IlcSpvId ilcSpvPutAlu(
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, op, 3 + idCount);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+    // Evaluate constant operations and simplify identities at compile time
+    IlcSpvId foldedId = foldConstantOp(module, op, false, resultTypeId, idCount, ids);
+    if (foldedId == 0 && idCount > 0) {
+        foldedId = simplifyAlu(module, op, resultTypeId, idCount, ids);
+    }
+    if (foldedId != 0) {
+        return foldedId;
+    }
+
+    IlcSpvId id = putValueInstr(module, op, 3 + idCount, resultTypeId, 0);
     for (int i = 0; i < idCount; i++) {
         putWord(buffer, ids[i]);
     }
@@ -860,11 +1650,27 @@ IlcSpvId ilcSpvPutBitcast(
     IlcSpvId operandId)
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+    const IlcSpvWord* words = getDefinition(module, operandId);
+    IlcSpvWord values[4];
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpBitcast, 4);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+    if (getTypeId(module, operandId) == resultTypeId) {
+        return operandId;
+    }
+
+    // Look through bitcast chains
+    if (words != NULL && module->definitions[operandId].bufferId == ID_CODE &&
+        (words[0] & SpvOpCodeMask) == SpvOpBitcast) {
+        return ilcSpvPutBitcast(module, resultTypeId, words[3]);
+    }
+
+    // Reinterpret constants
+    unsigned count = getConstantValues(module, operandId, values);
+    IlcSpvId constantId = count > 0 ? putConstantValues(module, resultTypeId, count, values) : 0;
+    if (constantId != 0) {
+        return constantId;
+    }
+
+    IlcSpvId id = putValueInstr(module, SpvOpBitcast, 4, resultTypeId, 0);
     putWord(buffer, operandId);
     return id;
 }
@@ -878,10 +1684,7 @@ IlcSpvId ilcSpvPutSelect(
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpSelect, 6);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+    IlcSpvId id = putValueInstr(module, SpvOpSelect, 6, resultTypeId, 0);
     putWord(buffer, conditionId);
     putWord(buffer, obj1Id);
     putWord(buffer, obj2Id);
@@ -914,6 +1717,25 @@ void ilcSpvPutMemoryBarrier(
     putWord(buffer, semanticsId);
 }
 
+IlcSpvId ilcSpvPutPhi(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    IlcSpvId resultId,
+    unsigned idCount,
+    const IlcSpvId* ids)
+{
+    IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
+
+    // Operands are (value, parent block) pairs
+    assert(idCount % 2 == 0);
+
+    IlcSpvId id = putValueInstr(module, SpvOpPhi, 3 + idCount, resultTypeId, resultId);
+    for (int i = 0; i < idCount; i++) {
+        putWord(buffer, ids[i]);
+    }
+    return id;
+}
+
 void ilcSpvPutLoopMerge(
     IlcSpvModule* module,
     IlcSpvId mergeBlockId,
@@ -991,10 +1813,12 @@ IlcSpvId ilcSpvPutGLSLOp(
 {
     IlcSpvBuffer* buffer = &module->buffer[ID_CODE];
 
-    IlcSpvId id = ilcSpvAllocId(module);
-    putInstr(buffer, SpvOpExtInst, 5 + idCount);
-    putWord(buffer, resultTypeId);
-    putWord(buffer, id);
+    IlcSpvId foldedId = foldConstantOp(module, glslOp, true, resultTypeId, idCount, ids);
+    if (foldedId != 0) {
+        return foldedId;
+    }
+
+    IlcSpvId id = putValueInstr(module, SpvOpExtInst, 5 + idCount, resultTypeId, 0);
     putWord(buffer, module->glsl450ImportId);
     putWord(buffer, glslOp);
     for (int i = 0; i < idCount; i++) {
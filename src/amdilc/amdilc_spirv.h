@@ -29,13 +29,30 @@ typedef IlcSpvWord IlcSpvId;
 
 typedef struct {
     unsigned wordCount;
+    unsigned wordCapacity;
     IlcSpvWord* words;
 } IlcSpvBuffer;
 
+typedef struct {
+    IlcSpvBufferId bufferId; // ID_MAIN marks an empty slot
+    unsigned offset;
+    uint32_t hash;
+} IlcSpvHashEntry;
+
+typedef struct {
+    IlcSpvBufferId bufferId; // ID_MAIN if unknown
+    unsigned offset;
+} IlcSpvDefinition;
+
 typedef struct {
     IlcSpvId currentId;
     IlcSpvId glsl450ImportId;
     IlcSpvBuffer buffer[ID_MAX];
+    unsigned hashEntryCount;
+    unsigned hashCapacity;
+    IlcSpvHashEntry* hashEntries; // Type and constant lookup table
+    unsigned definitionCount;
+    IlcSpvDefinition* definitions; // Defining instructions indexed by ID, used for folding
 } IlcSpvModule;
 
 void ilcSpvInit(
@@ -47,6 +64,11 @@ void ilcSpvFinish(
 uint32_t ilcSpvAllocId(
     IlcSpvModule* module);
 
+bool ilcSpvGetScalarConstant(
+    const IlcSpvModule* module,
+    IlcSpvId id,
+    IlcSpvWord* value);
+
 void ilcSpvPutExtension(
     IlcSpvModule* module,
     const char* name);
@@ -121,7 +143,8 @@ IlcSpvId ilcSpvPutSampledImageType(
 IlcSpvId ilcSpvPutArrayType(
     IlcSpvModule* module,
     IlcSpvId typeId,
-    IlcSpvId lengthId);
+    IlcSpvId lengthId,
+    bool unique);
 
 IlcSpvId ilcSpvPutRuntimeArrayType(
     IlcSpvModule* module,
@@ -155,6 +178,21 @@ IlcSpvId ilcSpvPutConstantComposite(
     unsigned consistuentCount,
     const IlcSpvId* consistuents);
 
+IlcSpvId ilcSpvPutSpecConstant(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    IlcSpvWord literal);
+
+IlcSpvId ilcSpvPutSpecConstantFalse(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId);
+
+IlcSpvId ilcSpvPutSpecConstantComposite(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    unsigned consistuentCount,
+    const IlcSpvId* consistuents);
+
 void ilcSpvPutFunction(
     IlcSpvModule* module,
     IlcSpvId resultType,
@@ -230,6 +268,14 @@ IlcSpvId ilcSpvPutCompositeExtract(
     unsigned indexCount,
     const IlcSpvId* indexes);
 
+IlcSpvId ilcSpvPutCompositeInsert(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    IlcSpvId objectId,
+    IlcSpvId compositeId,
+    unsigned indexCount,
+    const IlcSpvId* indexes);
+
 IlcSpvId ilcSpvPutSampledImage(
     IlcSpvModule* module,
     IlcSpvId resultTypeId,
@@ -318,6 +364,13 @@ void ilcSpvPutMemoryBarrier(
     IlcSpvId memoryId,
     IlcSpvId semanticsId);
 
+IlcSpvId ilcSpvPutPhi(
+    IlcSpvModule* module,
+    IlcSpvId resultTypeId,
+    IlcSpvId resultId,
+    unsigned idCount,
+    const IlcSpvId* ids);
+
 void ilcSpvPutLoopMerge(
     IlcSpvModule* module,
     IlcSpvId mergeBlockId,
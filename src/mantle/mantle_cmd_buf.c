@@ -125,36 +125,64 @@ static const DescriptorSetSlot* getDescriptorSetSlot(
     return NULL;
 }
 
+static const DescriptorSetSlot* getLinkConstSlot(
+    const GR_PIPELINE_SHADER* shaderInfo,
+    const DescriptorSetSlot* linkConstSlots,
+    const IlcBinding* binding)
+{
+    // Resources and UAVs can share the entity index of a constant buffer
+    if (linkConstSlots == NULL || binding->descriptorType != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+        return NULL;
+    }
+
+    // Link-time constant buffers are backed by the pipeline
+    for (unsigned i = 0; i < shaderInfo->linkConstBufferCount; i++) {
+        const GR_LINK_CONST_BUFFER* linkConstBuffer = &shaderInfo->pLinkConstBufferInfo[i];
+
+        if (binding->index == (ILC_BASE_RESOURCE_ID + linkConstBuffer->bufferId)) {
+            return &linkConstSlots[i];
+        }
+    }
+
+    return NULL;
+}
+
 static void updateVkDescriptorSet(
     const GrDevice* grDevice,
     GrCmdBuffer* grCmdBuffer,
     VkDescriptorSet vkDescriptorSet,
     unsigned slotOffset,
     const GR_PIPELINE_SHADER* shaderInfo,
+    const CompiledShader* compiledShader,
+    const DescriptorSetSlot* linkConstSlots,
     const GrDescriptorSet* grDescriptorSet,
     const DescriptorSetSlot* dynamicMemoryView)
 {
-    const GrShader* grShader = (GrShader*)shaderInfo->shader;
     const GR_DYNAMIC_MEMORY_VIEW_SLOT_INFO* dynamicMapping = &shaderInfo->dynamicMemoryViewMapping;
     VkResult vkRes;
 
-    if (grShader == NULL) {
+    if (compiledShader == NULL) {
         // Nothing to update
         return;
     }
 
-    VkDescriptorImageInfo* imageInfos = malloc(grShader->bindingCount *
+    VkDescriptorImageInfo* imageInfos = malloc(compiledShader->bindingCount *
                                                sizeof(VkDescriptorImageInfo));
-    VkDescriptorBufferInfo* bufferInfos = malloc(grShader->bindingCount *
+    VkDescriptorBufferInfo* bufferInfos = malloc(compiledShader->bindingCount *
                                                  sizeof(VkDescriptorBufferInfo));
-    VkBufferView* bufferViews = malloc(grShader->bindingCount * sizeof(VkBufferView));
-    VkWriteDescriptorSet* writes = malloc(grShader->bindingCount * sizeof(VkWriteDescriptorSet));
-
-    for (unsigned i = 0; i < grShader->bindingCount; i++) {
-        const IlcBinding* binding = &grShader->bindings[i];
+    VkBufferView* bufferViews = malloc(compiledShader->bindingCount * sizeof(VkBufferView));
+    VkWriteDescriptorSet* writes = malloc(compiledShader->bindingCount *
+                                          sizeof(VkWriteDescriptorSet));
+
+    for (unsigned i = 0; i < compiledShader->bindingCount; i++) {
+        const IlcBinding* binding = &compiledShader->bindings[i];
+        const DescriptorSetSlot* linkConstSlot =
+            getLinkConstSlot(shaderInfo, linkConstSlots, binding);
         const DescriptorSetSlot* slot;
 
-        if (dynamicMapping->slotObjectType != GR_SLOT_UNUSED &&
+        if (linkConstSlot != NULL) {
+            slot = linkConstSlot;
+        } else if (dynamicMapping->slotObjectType != GR_SLOT_UNUSED &&
             (binding->index == (ILC_BASE_RESOURCE_ID + dynamicMapping->shaderEntityIndex))) {
             slot = dynamicMemoryView;
         } else {
@@ -240,7 +268,8 @@ static void updateVkDescriptorSet(
 
             bufferViews[i] = bufferView;
             writes[i].pTexelBufferView = &bufferViews[i];
-        } else if (binding->descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+        } else if (binding->descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ||
+                   binding->descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
             if (slot->type != SLOT_TYPE_MEMORY_VIEW) {
                 LOGE("unexpected slot type %d for descriptor type %d\n",
                      slot->type, binding->descriptorType);
@@ -259,7 +288,7 @@ static void updateVkDescriptorSet(
         }
     }
 
-    VKD.vkUpdateDescriptorSets(grDevice->device, grShader->bindingCount, writes, 0, NULL);
+    VKD.vkUpdateDescriptorSets(grDevice->device, compiledShader->bindingCount, writes, 0, NULL);
 
     free(imageInfos);
     free(bufferInfos);
@@ -359,6 +388,8 @@ static void grCmdBufferUpdateDescriptorSets(
                               grCmdBuffer->bindPoint[bindPoint].descriptorSets[i],
                               grCmdBuffer->bindPoint[bindPoint].slotOffset,
                               &grPipeline->shaderInfos[i],
+                              grPipeline->compiledShaders[i],
+                              grPipeline->linkConstSlots[i],
                               grCmdBuffer->bindPoint[bindPoint].grDescriptorSet,
                               &grCmdBuffer->bindPoint[bindPoint].dynamicMemoryView);
     }
@@ -368,7 +399,56 @@ static void grCmdBufferUpdateDescriptorSets(
                                 grCmdBuffer->bindPoint[bindPoint].descriptorSets, 0, NULL);
 }
 
-static void grCmdBufferUpdateResources(
+static void grCmdBufferSetDynamicPipelineState(
+    GrCmdBuffer* grCmdBuffer,
+    const GrPipeline* grPipeline)
+{
+    static const VkPipelineColorBlendAttachmentState noBlendStates[GR_MAX_COLOR_TARGETS];
+    const GrDevice* grDevice = GET_OBJ_DEVICE(grCmdBuffer);
+    const GrColorBlendStateObject* grColorBlendState = grCmdBuffer->grColorBlendState;
+    const GrRasterStateObject* grRasterState = grCmdBuffer->grRasterState;
+
+    // Dynamic state must be set before drawing, use the variant defaults when unbound
+    const VkPipelineColorBlendAttachmentState* blendStates =
+        grColorBlendState != NULL ? grColorBlendState->states : noBlendStates;
+    VkPolygonMode polygonMode = grRasterState != NULL ? grRasterState->polygonMode :
+                                                        VK_POLYGON_MODE_FILL;
+
+    VKD.vkCmdSetPolygonModeEXT(grCmdBuffer->commandBuffer, polygonMode);
+
+    unsigned attachmentCount = 0;
+    VkBool32 blendEnables[GR_MAX_COLOR_TARGETS];
+    VkColorBlendEquationEXT blendEquations[GR_MAX_COLOR_TARGETS];
+
+    // Unused targets are packed out of the pipeline attachments
+    for (unsigned i = 0; i < GR_MAX_COLOR_TARGETS; i++) {
+        const VkPipelineColorBlendAttachmentState* blendState = &blendStates[i];
+
+        if (grPipeline->createInfo->colorWriteMasks[i] == ~0u) {
+            continue;
+        }
+
+        blendEnables[attachmentCount] = blendState->blendEnable;
+        blendEquations[attachmentCount] = (VkColorBlendEquationEXT) {
+            .srcColorBlendFactor = blendState->srcColorBlendFactor,
+            .dstColorBlendFactor = blendState->dstColorBlendFactor,
+            .colorBlendOp = blendState->colorBlendOp,
+            .srcAlphaBlendFactor = blendState->srcAlphaBlendFactor,
+            .dstAlphaBlendFactor = blendState->dstAlphaBlendFactor,
+            .alphaBlendOp = blendState->alphaBlendOp,
+        };
+        attachmentCount++;
+    }
+
+    if (attachmentCount > 0) {
+        VKD.vkCmdSetColorBlendEnableEXT(grCmdBuffer->commandBuffer, 0, attachmentCount,
+                                        blendEnables);
+        VKD.vkCmdSetColorBlendEquationEXT(grCmdBuffer->commandBuffer, 0, attachmentCount,
+                                          blendEquations);
+    }
+}
+
+static bool grCmdBufferUpdateResources(
     GrCmdBuffer* grCmdBuffer)
 {
     const GrDevice* grDevice = GET_OBJ_DEVICE(grCmdBuffer);
@@ -399,16 +479,31 @@ static void grCmdBufferUpdateResources(
     }
 
     if (grCmdBuffer->dirtyFlags & FLAG_DIRTY_PIPELINE) {
-        VkPipeline vkPipeline =
-            grPipelineFindOrCreateVkPipeline(grGraphicsPipeline,
-                                             grCmdBuffer->grColorBlendState,
-                                             grCmdBuffer->grRasterState);
+        VkPipeline vkPipeline = VK_NULL_HANDLE;
+        VkResult vkRes = grPipelineFindOrCreateVkPipeline(grGraphicsPipeline,
+                                                          grCmdBuffer->grColorBlendState,
+                                                          grCmdBuffer->grRasterState,
+                                                          &vkPipeline);
+
+        if (vkRes == VK_NOT_READY) {
+            // Variant still compiling in the background, retry on the next draw
+            grCmdBuffer->dirtyFlags = FLAG_DIRTY_PIPELINE;
+            return false;
+        }
+
+        // Creation errors are logged once, failed variants aren't retried
+        if (vkRes == VK_SUCCESS) {
+            VKD.vkCmdBindPipeline(grCmdBuffer->commandBuffer,
+                                  VK_PIPELINE_BIND_POINT_GRAPHICS, vkPipeline);
 
-        VKD.vkCmdBindPipeline(grCmdBuffer->commandBuffer,
-                              VK_PIPELINE_BIND_POINT_GRAPHICS, vkPipeline);
+            if (grDevice->hasExtendedDynamicState3) {
+                grCmdBufferSetDynamicPipelineState(grCmdBuffer, grGraphicsPipeline);
+            }
+        }
     }
 
     grCmdBuffer->dirtyFlags = 0;
+    return true;
 }
 
 // Command Buffer Building Functions
@@ -435,9 +530,11 @@ GR_VOID grCmdBindPipeline(
                                    FLAG_DIRTY_FRAMEBUFFER |
                                    FLAG_DIRTY_PIPELINE;
     } else {
+        VkPipeline vkPipeline = VK_NULL_HANDLE;
+
         // Pipeline creation isn't deferred for compute, bind now
-        VKD.vkCmdBindPipeline(grCmdBuffer->commandBuffer, vkBindPoint,
-                              grPipelineFindOrCreateVkPipeline(grPipeline, NULL, NULL));
+        grPipelineFindOrCreateVkPipeline(grPipeline, NULL, NULL, &vkPipeline);
+        VKD.vkCmdBindPipeline(grCmdBuffer->commandBuffer, vkBindPoint, vkPipeline);
 
         grCmdBuffer->dirtyFlags |= FLAG_DIRTY_COMPUTE_DESCRIPTOR_SETS;
     }
@@ -756,8 +853,8 @@ GR_VOID grCmdDraw(
     GrCmdBuffer* grCmdBuffer = (GrCmdBuffer*)cmdBuffer;
     const GrDevice* grDevice = GET_OBJ_DEVICE(grCmdBuffer);
 
-    if (grCmdBuffer->dirtyFlags != 0) {
-        grCmdBufferUpdateResources(grCmdBuffer);
+    if (grCmdBuffer->dirtyFlags != 0 && !grCmdBufferUpdateResources(grCmdBuffer)) {
+        return;
     }
 
     grCmdBufferBeginRenderPass(grCmdBuffer);
@@ -779,8 +876,8 @@ GR_VOID grCmdDrawIndexed(
     GrCmdBuffer* grCmdBuffer = (GrCmdBuffer*)cmdBuffer;
     const GrDevice* grDevice = GET_OBJ_DEVICE(grCmdBuffer);
 
-    if (grCmdBuffer->dirtyFlags != 0) {
-        grCmdBufferUpdateResources(grCmdBuffer);
+    if (grCmdBuffer->dirtyFlags != 0 && !grCmdBufferUpdateResources(grCmdBuffer)) {
+        return;
     }
 
     grCmdBufferBeginRenderPass(grCmdBuffer);
@@ -799,8 +896,8 @@ GR_VOID grCmdDrawIndirect(
     const GrDevice* grDevice = GET_OBJ_DEVICE(grCmdBuffer);
     GrGpuMemory* grGpuMemory = (GrGpuMemory*)mem;
 
-    if (grCmdBuffer->dirtyFlags != 0) {
-        grCmdBufferUpdateResources(grCmdBuffer);
+    if (grCmdBuffer->dirtyFlags != 0 && !grCmdBufferUpdateResources(grCmdBuffer)) {
+        return;
     }
 
     grCmdBufferBeginRenderPass(grCmdBuffer);
@@ -818,8 +915,8 @@ GR_VOID grCmdDrawIndexedIndirect(
     const GrDevice* grDevice = GET_OBJ_DEVICE(grCmdBuffer);
     GrGpuMemory* grGpuMemory = (GrGpuMemory*)mem;
 
-    if (grCmdBuffer->dirtyFlags != 0) {
-        grCmdBufferUpdateResources(grCmdBuffer);
+    if (grCmdBuffer->dirtyFlags != 0 && !grCmdBufferUpdateResources(grCmdBuffer)) {
+        return;
     }
 
     grCmdBufferBeginRenderPass(grCmdBuffer);
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <stdio.h>
 #include "mantle_internal.h"
 
@@ -19,6 +20,75 @@ static char* getGrvkEngineName(
     return grvkEngineName;
 }
 
+static bool isAsyncPipelinesEnabled()
+{
+    const char* envValue = getenv("GRVK_ASYNC_PIPELINES");
+
+    return envValue != NULL && strcmp(envValue, "1") == 0;
+}
+
+static DWORD getAsyncPipelineTimeout()
+{
+    const char* envValue = getenv("GRVK_ASYNC_PIPELINE_TIMEOUT");
+    char* end = NULL;
+
+    // Recording waits for background variants unless a timeout is set
+    if (envValue == NULL) {
+        return INFINITE;
+    }
+
+    // Reject signs, trailing characters and values that don't fit a finite timeout
+    errno = 0;
+    unsigned long timeout = strtoul(envValue, &end, 10);
+    if (envValue[0] < '0' || envValue[0] > '9' || *end != '\0' || errno == ERANGE ||
+        timeout >= INFINITE) {
+        LOGW("invalid GRVK_ASYNC_PIPELINE_TIMEOUT value \"%s\", waiting for variants\n", envValue);
+        return INFINITE;
+    }
+
+    return timeout;
+}
+
+static bool isExtendedDynamicState3Supported(
+    VkPhysicalDevice physicalDevice)
+{
+    uint32_t extensionCount = 0;
+    bool isExtensionSupported = false;
+
+    vki.vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, NULL);
+    VkExtensionProperties* extensions = malloc(extensionCount * sizeof(VkExtensionProperties));
+    vki.vkEnumerateDeviceExtensionProperties(physicalDevice, NULL, &extensionCount, extensions);
+
+    for (unsigned i = 0; i < extensionCount; i++) {
+        if (strcmp(extensions[i].extensionName,
+                   VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME) == 0) {
+            isExtensionSupported = true;
+            break;
+        }
+    }
+
+    free(extensions);
+
+    if (!isExtensionSupported) {
+        return false;
+    }
+
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        .pNext = NULL,
+    };
+    VkPhysicalDeviceFeatures2 deviceFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        .pNext = &extendedDynamicState3,
+    };
+
+    vki.vkGetPhysicalDeviceFeatures2(physicalDevice, &deviceFeatures);
+
+    return extendedDynamicState3.extendedDynamicState3PolygonMode &&
+           extendedDynamicState3.extendedDynamicState3ColorBlendEnable &&
+           extendedDynamicState3.extendedDynamicState3ColorBlendEquation;
+}
+
 // Initialization and Device Functions
 
 GR_RESULT grInitAndEnumerateGpus(
@@ -393,9 +463,20 @@ GR_RESULT grCreateDevice(
         .pNext = NULL,
         .separateDepthStencilLayouts = VK_TRUE,
     };
+    // Blend and polygon mode are baked into pipeline variants without it
+    bool hasExtendedDynamicState3 =
+        isExtendedDynamicState3Supported(grPhysicalGpu->physicalDevice);
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT extendedDynamicState3 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT,
+        .pNext = &separateDsLayouts,
+        .extendedDynamicState3PolygonMode = VK_TRUE,
+        .extendedDynamicState3ColorBlendEnable = VK_TRUE,
+        .extendedDynamicState3ColorBlendEquation = VK_TRUE,
+    };
     VkPhysicalDeviceExtendedDynamicStateFeaturesEXT extendedDynamicState = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT,
-        .pNext = &separateDsLayouts,
+        .pNext = hasExtendedDynamicState3 ? (void*)&extendedDynamicState3 :
+                                            (void*)&separateDsLayouts,
         .extendedDynamicState = VK_TRUE,
     };
     VkPhysicalDeviceShaderDemoteToHelperInvocationFeaturesEXT demoteToHelperInvocation = {
@@ -424,7 +505,10 @@ GR_RESULT grCreateDevice(
         VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME,
         VK_EXT_SHADER_DEMOTE_TO_HELPER_INVOCATION_EXTENSION_NAME,
         VK_KHR_SWAPCHAIN_EXTENSION_NAME,
+        VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME, // Optional, must stay last
     };
+    unsigned deviceExtensionCount = hasExtendedDynamicState3 ? COUNT_OF(deviceExtensions) :
+                                                               COUNT_OF(deviceExtensions) - 1;
 
     const VkDeviceCreateInfo createInfo = {
         .sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
@@ -434,7 +518,7 @@ GR_RESULT grCreateDevice(
         .pQueueCreateInfos = queueCreateInfos,
         .enabledLayerCount = 0,
         .ppEnabledLayerNames = NULL,
-        .enabledExtensionCount = COUNT_OF(deviceExtensions),
+        .enabledExtensionCount = deviceExtensionCount,
         .ppEnabledExtensionNames = deviceExtensions,
         .pEnabledFeatures = NULL,
     };
@@ -445,7 +529,7 @@ GR_RESULT grCreateDevice(
 
         if (vkRes == VK_ERROR_EXTENSION_NOT_PRESENT) {
             LOGE("missing extension. make sure your Vulkan driver supports:\n");
-            for (unsigned i = 0; i < COUNT_OF(deviceExtensions); i++) {
+            for (unsigned i = 0; i < deviceExtensionCount; i++) {
                 LOGE("- %s\n", deviceExtensions[i]);
             }
         }
@@ -468,8 +552,20 @@ GR_RESULT grCreateDevice(
         .memoryProperties = memoryProperties,
         .universalQueueIndex = universalQueueIndex,
         .computeQueueIndex = computeQueueIndex,
+        .hasExtendedDynamicState3 = hasExtendedDynamicState3,
+        .isAsyncPipelinesEnabled = isAsyncPipelinesEnabled(),
+        .asyncPipelineTimeout = getAsyncPipelineTimeout(),
+        .shaderCompiler = NULL, // Initialized below
+        .pipelineCache = VK_NULL_HANDLE, // Initialized below
+        .pipelineCacheSavedSize = 0, // Initialized below
+        .pipelineCacheSaveTime = 0, // Initialized below
     };
 
+    LOGV("extended dynamic state 3 %s\n", hasExtendedDynamicState3 ? "enabled" : "unsupported");
+
+    grDevice->shaderCompiler = shaderCompilerCreate(grDevice);
+    pipelineCacheLoad(grDevice);
+
     *pDevice = (GR_DEVICE)grDevice;
 
 bail:
@@ -497,6 +593,9 @@ GR_RESULT grDestroyDevice(
         return GR_ERROR_INVALID_OBJECT_TYPE;
     }
 
+    shaderCompilerDestroy(grDevice->shaderCompiler);
+    pipelineCacheSave(grDevice);
+    VKD.vkDestroyPipelineCache(grDevice->device, grDevice->pipelineCache, NULL);
     VKD.vkDestroyDevice(grDevice->device, NULL);
     free(grDevice);
 
@@ -10,7 +10,9 @@
 #include "mantle/mantleWsiWinExt.h"
 #include "logger.h"
 #include "mantle_object.h"
+#include "pipeline_cache.h"
 #include "quirk.h"
+#include "shader_compiler.h"
 #include "vulkan_loader.h"
 
 #define INVALID_QUEUE_INDEX (~0u)
@@ -148,4 +150,8 @@ VkImageSubresourceRange getVkImageSubresourceRange(
     GR_IMAGE_SUBRESOURCE_RANGE subresourceRange,
     bool isCubemap);
 
+uint64_t getHash(
+    const void* data,
+    unsigned size);
+
 #endif // MANTLE_INTERNAL_H_
@@ -9,6 +9,7 @@
 #include "amdilc.h"
 
 #define MAX_STAGE_COUNT 5 // VS, HS, DS, GS, PS
+#define PIPELINE_SLOT_BUCKET_COUNT 16
 
 #define GET_OBJ_TYPE(obj) \
     (((GrBaseObject*)(obj))->grObjType)
@@ -59,6 +60,8 @@ typedef struct _GrFence GrFence;
 typedef struct _GrPipeline GrPipeline;
 typedef struct _GrRasterStateObject GrRasterStateObject;
 typedef struct _GrViewportStateObject GrViewportStateObject;
+typedef struct _ShaderCompiler ShaderCompiler;
+typedef struct _CompiledShader CompiledShader;
 
 typedef struct _DescriptorSetSlot
 {
@@ -98,14 +101,34 @@ typedef struct _PipelineCreateInfo
     VkColorComponentFlags colorWriteMasks[GR_MAX_COLOR_TARGETS];
 } PipelineCreateInfo;
 
+typedef struct _PipelineSlot PipelineSlot;
+
 typedef struct _PipelineSlot
 {
     VkPipeline pipeline;
-    // TODO keep track of individual parameters to minimize pipeline count
-    const GrColorBlendStateObject* grColorBlendState;
-    const GrRasterStateObject* grRasterState;
+    VkResult result; // VK_NOT_READY until the pipeline is created
+    uint64_t hash; // Of the blend states and polygon mode
+    VkPipelineColorBlendAttachmentState blendStates[GR_MAX_COLOR_TARGETS];
+    VkPolygonMode polygonMode;
+    PipelineSlot* next; // Immutable once published
 } PipelineSlot;
 
+typedef struct _CompiledShader
+{
+    uint64_t hash; // Of the IL code
+    unsigned codeSize;
+    void* code; // IL code, kept to tell apart hash collisions
+    VkShaderModule shaderModule; // Valid once compiled
+    unsigned spirvSize; // Valid once compiled
+    uint32_t* spirvCode; // Valid once compiled, kept for grStorePipeline
+    unsigned bindingCount; // Valid once compiled
+    IlcBinding* bindings; // Valid once compiled
+    bool isCompiled; // Guarded by the shader compiler mutex
+    GR_RESULT compileResult;
+    unsigned refCount; // Guarded by the shader compiler mutex
+    CompiledShader* next; // Next in the shader compiler registry bucket
+} CompiledShader;
+
 // Base object
 typedef struct _GrBaseObject {
     GrObjectType grObjType;
@@ -161,6 +184,7 @@ typedef struct _GrCmdBuffer {
 typedef struct _GrColorBlendStateObject {
     GrObject grObj;
     VkPipelineColorBlendAttachmentState states[GR_MAX_COLOR_TARGETS];
+    uint64_t statesHash; // Looks up pipeline variants
     float blendConstants[4];
 } GrColorBlendStateObject;
 
@@ -203,6 +227,13 @@ typedef struct _GrDevice {
     VkPhysicalDeviceMemoryProperties memoryProperties;
     unsigned universalQueueIndex;
     unsigned computeQueueIndex;
+    bool hasExtendedDynamicState3; // Blend and polygon mode are dynamic, one variant per pipeline
+    bool isAsyncPipelinesEnabled; // Missing variants are created on the shader compiler threads
+    DWORD asyncPipelineTimeout; // Milliseconds to wait for a background variant, or INFINITE
+    ShaderCompiler* shaderCompiler;
+    VkPipelineCache pipelineCache;
+    size_t pipelineCacheSavedSize; // Cache data size at the last save
+    volatile LONGLONG pipelineCacheSaveTime; // Tick count at the last save
 } GrDevice;
 
 typedef struct _GrEvent {
@@ -257,15 +288,30 @@ typedef struct _GrPhysicalGpu {
 typedef struct _GrPipeline {
     GrObject grObj;
     PipelineCreateInfo* createInfo;
-    unsigned pipelineSlotCount;
-    PipelineSlot* pipelineSlots;
-    CRITICAL_SECTION pipelineSlotsMutex;
+    GR_FLAGS createFlags; // Kept for grStorePipeline
+    GR_PIPELINE_IA_STATE iaState; // Kept for grStorePipeline
+    GR_PIPELINE_TESS_STATE tessState; // Kept for grStorePipeline
+    GR_PIPELINE_RS_STATE rsState; // Kept for grStorePipeline
+    GR_PIPELINE_CB_STATE cbState; // Kept for grStorePipeline
+    GR_PIPELINE_DB_STATE dbState; // Kept for grStorePipeline
+    PipelineSlot* volatile pipelineSlots[PIPELINE_SLOT_BUCKET_COUNT]; // Read without locking
+    PipelineSlot* pendingPipelineSlots; // Variants being created
+    CRITICAL_SECTION pipelineSlotsMutex; // Guards slot insertion, pending slots and stored data
+    CONDITION_VARIABLE pipelineSlotsCond; // Signaled when a variant is created
+    unsigned pipelineSlotCount; // Published variants
+    void* storedData; // Built by grStorePipeline, reused until a variant is published
+    size_t storedDataSize;
+    unsigned storedSlotCount; // Published variants when the stored data was built
     VkPipelineLayout pipelineLayout;
     VkRenderPass renderPass;
     unsigned descriptorTypeCounts[VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1];
     unsigned stageCount;
     VkDescriptorSetLayout descriptorSetLayouts[MAX_STAGE_COUNT];
     GR_PIPELINE_SHADER shaderInfos[MAX_STAGE_COUNT];
+    CompiledShader* compiledShaders[MAX_STAGE_COUNT]; // Referenced, outlive the shader objects
+    VkBuffer linkConstBuffer;
+    VkDeviceMemory linkConstMemory;
+    DescriptorSetSlot* linkConstSlots[MAX_STAGE_COUNT]; // Parallel to pLinkConstBufferInfo
 } GrPipeline;
 
 typedef struct _GrQueueSemaphore {
@@ -290,9 +336,7 @@ typedef struct _GrSampler {
 
 typedef struct _GrShader {
     GrObject grObj;
-    VkShaderModule shaderModule;
-    unsigned bindingCount;
-    IlcBinding* bindings;
+    CompiledShader* compiledShader; // Shared by shaders with identical code
 } GrShader;
 
 typedef struct _GrQueue {
@@ -339,9 +383,17 @@ unsigned grImageGetBufferDepthPitch(
 void grGpuMemoryBindBuffer(
     GrGpuMemory* grGpuMemory);
 
-VkPipeline grPipelineFindOrCreateVkPipeline(
+void grPipelineCreateVkPipeline(
+    GrPipeline* grPipeline,
+    PipelineSlot* pipelineSlot);
+
+void grPipelineDestroyResources(
+    GrPipeline* grPipeline);
+
+VkResult grPipelineFindOrCreateVkPipeline(
     GrPipeline* grPipeline,
     const GrColorBlendStateObject* grColorBlendState,
-    const GrRasterStateObject* grRasterState);
+    const GrRasterStateObject* grRasterState,
+    VkPipeline* vkPipeline);
 
 #endif // GR_OBJECT_H_
@@ -36,9 +36,17 @@ GR_RESULT grDestroyObject(
 
         VKD.vkDestroyImageView(grDevice->device, grImageView->imageView, NULL);
     }   break;
-    case GR_OBJ_TYPE_SHADER:
-        // FIXME actually destroy it?
-        return GR_SUCCESS;
+    case GR_OBJ_TYPE_PIPELINE: {
+        GrPipeline* grPipeline = (GrPipeline*)grObject;
+
+        grPipelineDestroyResources(grPipeline);
+    }   break;
+    case GR_OBJ_TYPE_SHADER: {
+        GrShader* grShader = (GrShader*)grObject;
+
+        // Pipelines hold their own references
+        shaderCompilerRelease(grDevice->shaderCompiler, grShader->compiledShader);
+    }   break;
     default:
         LOGW("unsupported object type %u\n", grObject->grObjType);
         return GR_ERROR_INVALID_OBJECT_TYPE;
@@ -1,11 +1,38 @@
 #include "mantle_internal.h"
 #include "amdilc.h"
 
+// Largest minUniformBufferOffsetAlignment allowed by the Vulkan spec
+#define LINK_CONST_ALIGNMENT    (256)
+#define PIPELINE_DATA_MAGIC     (0x50564B47) // "GKVP"
+#define PIPELINE_DATA_VERSION   (2)
+// Bounds the recursion when reading nested descriptor sets from untrusted pipeline data
+#define MAX_DESCRIPTOR_SET_DEPTH (32)
+
 typedef struct _Stage {
     const GR_PIPELINE_SHADER* shader;
     const VkShaderStageFlagBits flags;
+    CompiledShader* compiledShader; // Null if the stage is unused
 } Stage;
 
+typedef struct _PipelineDataHeader {
+    uint32_t magic;
+    uint32_t version;
+    char grvkVersion[32]; // Data is only loaded by the GRVK build that stored it
+    uint32_t isCompute;
+} PipelineDataHeader;
+
+typedef struct _PipelineWriter {
+    uint8_t* data;
+    size_t size;
+    size_t capacity;
+} PipelineWriter;
+
+typedef struct _PipelineReader {
+    const uint8_t* data;
+    size_t size;
+    size_t offset;
+} PipelineReader;
+
 static void copyDescriptorSetMapping(
     GR_DESCRIPTOR_SET_MAPPING* dst,
     const GR_DESCRIPTOR_SET_MAPPING* src);
@@ -37,19 +64,281 @@ static void copyDescriptorSetMapping(
     }
 }
 
+static void freeDescriptorSetMapping(
+    const GR_DESCRIPTOR_SET_MAPPING* mapping)
+{
+    for (unsigned i = 0; i < mapping->descriptorCount; i++) {
+        const GR_DESCRIPTOR_SLOT_INFO* slotInfo = &mapping->pDescriptorInfo[i];
+
+        if (slotInfo->slotObjectType == GR_SLOT_NEXT_DESCRIPTOR_SET &&
+            slotInfo->pNextLevelSet != NULL) {
+            freeDescriptorSetMapping(slotInfo->pNextLevelSet);
+            free((void*)slotInfo->pNextLevelSet);
+        }
+    }
+
+    free((void*)mapping->pDescriptorInfo);
+}
+
 static void copyPipelineShader(
     GR_PIPELINE_SHADER* dst,
     const GR_PIPELINE_SHADER* src)
 {
-    dst->shader = src->shader;
+    // The shader object may be destroyed while the pipeline is still in use,
+    // the compiled shader is referenced separately
+    dst->shader = GR_NULL_HANDLE;
     for (unsigned i = 0; i < COUNT_OF(dst->descriptorSetMapping); i++) {
         copyDescriptorSetMapping(&dst->descriptorSetMapping[i], &src->descriptorSetMapping[i]);
     }
-    dst->linkConstBufferCount = 0; // Ignored
-    dst->pLinkConstBufferInfo = NULL; // Ignored
+    dst->linkConstBufferCount = src->linkConstBufferCount;
+    dst->pLinkConstBufferInfo = malloc(src->linkConstBufferCount * sizeof(GR_LINK_CONST_BUFFER));
+    for (unsigned i = 0; i < src->linkConstBufferCount; i++) {
+        const GR_LINK_CONST_BUFFER* linkConstBuffer = &src->pLinkConstBufferInfo[i];
+        void* data = malloc(linkConstBuffer->bufferSize);
+
+        memcpy(data, linkConstBuffer->pBufferData, linkConstBuffer->bufferSize);
+        ((GR_LINK_CONST_BUFFER*)dst->pLinkConstBufferInfo)[i] = (GR_LINK_CONST_BUFFER) {
+            .bufferId = linkConstBuffer->bufferId,
+            .bufferSize = linkConstBuffer->bufferSize,
+            .pBufferData = data,
+        };
+    }
     dst->dynamicMemoryViewMapping = src->dynamicMemoryViewMapping;
 }
 
+static void freePipelineShaderCopy(
+    const GR_PIPELINE_SHADER* shader)
+{
+    for (unsigned i = 0; i < COUNT_OF(shader->descriptorSetMapping); i++) {
+        freeDescriptorSetMapping(&shader->descriptorSetMapping[i]);
+    }
+    for (unsigned i = 0; i < shader->linkConstBufferCount; i++) {
+        free((void*)shader->pLinkConstBufferInfo[i].pBufferData);
+    }
+    free((void*)shader->pLinkConstBufferInfo);
+}
+
+static CompiledShader* getStageCompiledShader(
+    const GR_PIPELINE_SHADER* shader,
+    CompiledShader* const* loadedShaders,
+    unsigned index)
+{
+    // Loaded pipelines have no shader objects
+    if (loadedShaders != NULL) {
+        return loadedShaders[index];
+    }
+
+    const GrShader* grShader = (GrShader*)shader->shader;
+
+    return grShader != NULL ? grShader->compiledShader : NULL;
+}
+
+static CompiledShader* getPipelineCompiledShader(
+    const GrDevice* grDevice,
+    const Stage* stage)
+{
+    if (stage->compiledShader == NULL) {
+        return NULL;
+    }
+
+    // The shader object may be destroyed while the pipeline is still in use
+    shaderCompilerRetain(grDevice->shaderCompiler, stage->compiledShader);
+    return stage->compiledShader;
+}
+
+static VkSpecializationInfo* getVkSpecializationInfo(
+    const GR_PIPELINE_SHADER* shader)
+{
+    unsigned mapEntryCount = 0;
+    unsigned dataSize = sizeof(VkBool32);
+
+    if (shader->linkConstBufferCount == 0) {
+        return NULL;
+    }
+
+    // Each link-time constant buffer sets its flag and one specialization constant per dword
+    for (unsigned i = 0; i < shader->linkConstBufferCount; i++) {
+        const GR_LINK_CONST_BUFFER* linkConstBuffer = &shader->pLinkConstBufferInfo[i];
+        unsigned dwordCount = (linkConstBuffer->bufferSize + sizeof(uint32_t) - 1) /
+                              sizeof(uint32_t);
+
+        mapEntryCount += 1 + dwordCount;
+        dataSize += dwordCount * sizeof(uint32_t);
+    }
+
+    VkSpecializationMapEntry* mapEntries = malloc(mapEntryCount *
+                                                  sizeof(VkSpecializationMapEntry));
+    uint8_t* data = malloc(dataSize);
+    const VkBool32 isLinked = VK_TRUE;
+    unsigned mapEntryIndex = 0;
+    unsigned offset = sizeof(VkBool32);
+
+    memcpy(data, &isLinked, sizeof(isLinked));
+
+    for (unsigned i = 0; i < shader->linkConstBufferCount; i++) {
+        const GR_LINK_CONST_BUFFER* linkConstBuffer = &shader->pLinkConstBufferInfo[i];
+        unsigned dwordCount = (linkConstBuffer->bufferSize + sizeof(uint32_t) - 1) /
+                              sizeof(uint32_t);
+
+        mapEntries[mapEntryIndex] = (VkSpecializationMapEntry) {
+            .constantID = ILC_LINK_CONST_FLAG_SPEC_ID(linkConstBuffer->bufferId),
+            .offset = 0,
+            .size = sizeof(VkBool32),
+        };
+        mapEntryIndex++;
+
+        // Pad the last dword with zeros
+        memset(&data[offset], 0, dwordCount * sizeof(uint32_t));
+        memcpy(&data[offset], linkConstBuffer->pBufferData, linkConstBuffer->bufferSize);
+
+        for (unsigned j = 0; j < dwordCount; j++) {
+            mapEntries[mapEntryIndex] = (VkSpecializationMapEntry) {
+                .constantID = ILC_LINK_CONST_SPEC_ID(linkConstBuffer->bufferId, j),
+                .offset = offset + j * sizeof(uint32_t),
+                .size = sizeof(uint32_t),
+            };
+            mapEntryIndex++;
+        }
+
+        offset += dwordCount * sizeof(uint32_t);
+    }
+
+    VkSpecializationInfo* specInfo = malloc(sizeof(VkSpecializationInfo));
+    *specInfo = (VkSpecializationInfo) {
+        .mapEntryCount = mapEntryCount,
+        .pMapEntries = mapEntries,
+        .dataSize = dataSize,
+        .pData = data,
+    };
+
+    return specInfo;
+}
+
+static void freeVkSpecializationInfo(
+    const VkSpecializationInfo* specInfo)
+{
+    if (specInfo != NULL) {
+        free((void*)specInfo->pMapEntries);
+        free((void*)specInfo->pData);
+        free((void*)specInfo);
+    }
+}
+
+static GR_RESULT createLinkConstBuffer(
+    const GrDevice* grDevice,
+    VkBuffer* buffer,
+    VkDeviceMemory* memory,
+    DescriptorSetSlot** slots,
+    unsigned stageCount,
+    const Stage* stages)
+{
+    VkDeviceSize size = 0;
+    VkResult vkRes;
+
+    // Dynamically indexed link-time constants are read from a buffer owned by the pipeline
+    for (unsigned i = 0; i < stageCount; i++) {
+        const GR_PIPELINE_SHADER* shader = stages[i].shader;
+
+        for (unsigned j = 0; j < shader->linkConstBufferCount; j++) {
+            size += (shader->pLinkConstBufferInfo[j].bufferSize + LINK_CONST_ALIGNMENT - 1) &
+                    ~(VkDeviceSize)(LINK_CONST_ALIGNMENT - 1);
+        }
+    }
+
+    if (size == 0) {
+        return GR_SUCCESS;
+    }
+
+    const VkBufferCreateInfo bufferCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .size = size,
+        .usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        .queueFamilyIndexCount = 0,
+        .pQueueFamilyIndices = NULL,
+    };
+
+    vkRes = VKD.vkCreateBuffer(grDevice->device, &bufferCreateInfo, NULL, buffer);
+    if (vkRes != VK_SUCCESS) {
+        LOGE("vkCreateBuffer failed (%d)\n", vkRes);
+        return getGrResult(vkRes);
+    }
+
+    VkMemoryRequirements memReqs;
+    VKD.vkGetBufferMemoryRequirements(grDevice->device, *buffer, &memReqs);
+
+    const VkMemoryPropertyFlags memoryFlags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    unsigned memoryTypeIndex = 0;
+    for (; memoryTypeIndex < grDevice->memoryProperties.memoryTypeCount; memoryTypeIndex++) {
+        const VkMemoryType* memoryType =
+            &grDevice->memoryProperties.memoryTypes[memoryTypeIndex];
+
+        if ((memReqs.memoryTypeBits & (1 << memoryTypeIndex)) &&
+            (memoryType->propertyFlags & memoryFlags) == memoryFlags) {
+            break;
+        }
+    }
+
+    if (memoryTypeIndex == grDevice->memoryProperties.memoryTypeCount) {
+        LOGE("no host-visible memory type for link-time constants\n");
+        VKD.vkDestroyBuffer(grDevice->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return GR_ERROR_OUT_OF_MEMORY;
+    }
+
+    const VkMemoryAllocateInfo allocateInfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .pNext = NULL,
+        .allocationSize = memReqs.size,
+        .memoryTypeIndex = memoryTypeIndex,
+    };
+
+    vkRes = VKD.vkAllocateMemory(grDevice->device, &allocateInfo, NULL, memory);
+    if (vkRes != VK_SUCCESS) {
+        LOGE("vkAllocateMemory failed (%d)\n", vkRes);
+        VKD.vkDestroyBuffer(grDevice->device, *buffer, NULL);
+        *buffer = VK_NULL_HANDLE;
+        return getGrResult(vkRes);
+    }
+
+    VKD.vkBindBufferMemory(grDevice->device, *buffer, *memory, 0);
+
+    uint8_t* data = NULL;
+    VKD.vkMapMemory(grDevice->device, *memory, 0, VK_WHOLE_SIZE, 0, (void**)&data);
+
+    VkDeviceSize offset = 0;
+    for (unsigned i = 0; i < stageCount; i++) {
+        const GR_PIPELINE_SHADER* shader = stages[i].shader;
+
+        slots[i] = malloc(shader->linkConstBufferCount * sizeof(DescriptorSetSlot));
+
+        for (unsigned j = 0; j < shader->linkConstBufferCount; j++) {
+            const GR_LINK_CONST_BUFFER* linkConstBuffer = &shader->pLinkConstBufferInfo[j];
+
+            memcpy(&data[offset], linkConstBuffer->pBufferData, linkConstBuffer->bufferSize);
+
+            slots[i][j] = (DescriptorSetSlot) {
+                .type = SLOT_TYPE_MEMORY_VIEW,
+                .memoryView = {
+                    .vkBuffer = *buffer,
+                    .vkFormat = VK_FORMAT_UNDEFINED,
+                    .offset = offset,
+                    .range = linkConstBuffer->bufferSize,
+                },
+            };
+
+            offset += (linkConstBuffer->bufferSize + LINK_CONST_ALIGNMENT - 1) &
+                      ~(VkDeviceSize)(LINK_CONST_ALIGNMENT - 1);
+        }
+    }
+
+    VKD.vkUnmapMemory(grDevice->device, *memory);
+    return GR_SUCCESS;
+}
+
 static VkDescriptorSetLayout getVkDescriptorSetLayout(
     const GrDevice* grDevice,
     const Stage* stage)
@@ -58,14 +347,14 @@ static VkDescriptorSetLayout getVkDescriptorSetLayout(
     unsigned bindingCount = 0;
     VkDescriptorSetLayoutBinding* bindings = NULL;
 
-    if (stage->shader->shader != GR_NULL_HANDLE) {
-        const GrShader* grShader = stage->shader->shader;
+    if (stage->compiledShader != NULL) {
+        const CompiledShader* compiledShader = stage->compiledShader;
 
-        bindingCount = grShader->bindingCount;
+        bindingCount = compiledShader->bindingCount;
         bindings = malloc(bindingCount * sizeof(VkDescriptorSetLayoutBinding));
 
-        for (unsigned i = 0; i < grShader->bindingCount; i++) {
-            const IlcBinding* binding = &grShader->bindings[i];
+        for (unsigned i = 0; i < compiledShader->bindingCount; i++) {
+            const IlcBinding* binding = &compiledShader->bindings[i];
 
             bindings[i] = (VkDescriptorSetLayoutBinding) {
                 .binding = binding->index,
@@ -128,11 +417,11 @@ static void updateDescriptorTypeCounts(
 {
     // Count descriptor types from shader bindings in all stages
     for (unsigned i = 0; i < stageCount; i++) {
-        const GrShader* grShader = (GrShader*)stages[i].shader->shader;
+        const CompiledShader* compiledShader = stages[i].compiledShader;
 
-        if (grShader != NULL) {
-            for (unsigned j = 0; j < grShader->bindingCount; j++) {
-                const IlcBinding* binding = &grShader->bindings[j];
+        if (compiledShader != NULL) {
+            for (unsigned j = 0; j < compiledShader->bindingCount; j++) {
+                const IlcBinding* binding = &compiledShader->bindings[j];
 
                 if (binding->descriptorType >= descriptorTypeCountSize) {
                     LOGE("unexpected descriptor type %d\n", binding->descriptorType);
@@ -257,14 +546,39 @@ static VkRenderPass getVkRenderPass(
     return renderPass;
 }
 
-static VkPipeline getVkPipeline(
+static VkPipelineCache getPipelineCache(
+    const GrDevice* grDevice,
+    VkPipelineCache vkPipelineCache)
+{
+    // Loaded pipelines are created from their stored cache
+    return vkPipelineCache != VK_NULL_HANDLE ? vkPipelineCache : grDevice->pipelineCache;
+}
+
+static const PipelineSlot* findPipelineSlot(
+    const PipelineSlot* slot,
+    uint64_t hash,
+    const VkPipelineColorBlendAttachmentState* blendStates,
+    VkPolygonMode polygonMode)
+{
+    for (; slot != NULL; slot = slot->next) {
+        if (slot->hash == hash && slot->polygonMode == polygonMode &&
+            memcmp(slot->blendStates, blendStates, sizeof(slot->blendStates)) == 0) {
+            return slot;
+        }
+    }
+
+    return NULL;
+}
+
+static VkResult getVkPipeline(
     const GrPipeline* grPipeline,
-    const GrColorBlendStateObject* grColorBlendState,
-    const GrRasterStateObject* grRasterState)
+    VkPipelineCache vkPipelineCache,
+    const VkPipelineColorBlendAttachmentState* blendStates,
+    VkPolygonMode polygonMode,
+    VkPipeline* vkPipeline)
 {
     const GrDevice* grDevice = GET_OBJ_DEVICE(grPipeline);
     const PipelineCreateInfo* createInfo = grPipeline->createInfo;
-    VkPipeline vkPipeline = VK_NULL_HANDLE;
     VkResult vkRes;
 
     const VkPipelineVertexInputStateCreateInfo vertexInputStateCreateInfo = {
@@ -316,7 +630,7 @@ static VkPipeline getVkPipeline(
         .flags = 0,
         .depthClampEnable = VK_TRUE,
         .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode = grRasterState->polygonMode,
+        .polygonMode = polygonMode,
         .cullMode = 0, // Dynamic state
         .frontFace = 0, // Dynamic state
         .depthBiasEnable = VK_TRUE,
@@ -357,7 +671,7 @@ static VkPipeline getVkPipeline(
     VkPipelineColorBlendAttachmentState attachments[GR_MAX_COLOR_TARGETS];
 
     for (unsigned i = 0; i < GR_MAX_COLOR_TARGETS; i++) {
-        const VkPipelineColorBlendAttachmentState* blendState = &grColorBlendState->states[i];
+        const VkPipelineColorBlendAttachmentState* blendState = &blendStates[i];
         VkColorComponentFlags colorWriteMask = createInfo->colorWriteMasks[i];
 
         if (colorWriteMask == ~0u) {
@@ -405,13 +719,18 @@ static VkPipeline getVkPipeline(
         VK_DYNAMIC_STATE_DEPTH_BOUNDS_TEST_ENABLE_EXT,
         VK_DYNAMIC_STATE_STENCIL_TEST_ENABLE_EXT,
         VK_DYNAMIC_STATE_STENCIL_OP_EXT,
+        // Must stay last, dropped without VK_EXT_extended_dynamic_state3
+        VK_DYNAMIC_STATE_POLYGON_MODE_EXT,
+        VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT,
+        VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT,
     };
 
     const VkPipelineDynamicStateCreateInfo dynamicStateCreateInfo = {
         .sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .dynamicStateCount = COUNT_OF(dynamicStates),
+        .dynamicStateCount = grDevice->hasExtendedDynamicState3 ? COUNT_OF(dynamicStates) :
+                                                                  COUNT_OF(dynamicStates) - 3,
         .pDynamicStates = dynamicStates,
     };
 
@@ -437,111 +756,70 @@ static VkPipeline getVkPipeline(
         .basePipelineIndex = 0,
     };
 
-    vkRes = VKD.vkCreateGraphicsPipelines(grDevice->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
-                                          NULL, &vkPipeline);
+    vkRes = VKD.vkCreateGraphicsPipelines(grDevice->device, vkPipelineCache, 1,
+                                          &pipelineCreateInfo, NULL, vkPipeline);
     if (vkRes != VK_SUCCESS) {
         LOGE("vkCreateGraphicsPipelines failed (%d)\n", vkRes);
     }
 
-    return vkPipeline;
-}
-
-// Exported Functions
-
-VkPipeline grPipelineFindOrCreateVkPipeline(
-    GrPipeline* grPipeline,
-    const GrColorBlendStateObject* grColorBlendState,
-    const GrRasterStateObject* grRasterState)
-{
-    VkPipeline vkPipeline = VK_NULL_HANDLE;
-
-    EnterCriticalSection(&grPipeline->pipelineSlotsMutex);
-
-    for (unsigned i = 0; i < grPipeline->pipelineSlotCount; i++) {
-        const PipelineSlot* slot = &grPipeline->pipelineSlots[i];
-
-        if (grColorBlendState == slot->grColorBlendState &&
-            grRasterState == slot->grRasterState) {
-            vkPipeline = slot->pipeline;
-            break;
-        }
-    }
-
-    if (vkPipeline == VK_NULL_HANDLE) {
-        vkPipeline = getVkPipeline(grPipeline, grColorBlendState, grRasterState);
-
-        grPipeline->pipelineSlotCount++;
-        grPipeline->pipelineSlots = realloc(grPipeline->pipelineSlots,
-                                            grPipeline->pipelineSlotCount * sizeof(PipelineSlot));
-        grPipeline->pipelineSlots[grPipeline->pipelineSlotCount - 1] = (PipelineSlot) {
-            .pipeline = vkPipeline,
-            .grColorBlendState = grColorBlendState,
-            .grRasterState = grRasterState,
-        };
-    }
-
-    LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
-
-    return vkPipeline;
+    return vkRes;
 }
 
-// Shader and Pipeline Functions
-
-GR_RESULT grCreateShader(
-    GR_DEVICE device,
-    const GR_SHADER_CREATE_INFO* pCreateInfo,
-    GR_SHADER* pShader)
+static VkResult createVkComputePipeline(
+    const GrDevice* grDevice,
+    VkPipelineCache vkPipelineCache,
+    GR_FLAGS createFlags,
+    const GR_PIPELINE_SHADER* shader,
+    VkShaderModule shaderModule,
+    VkPipelineLayout pipelineLayout,
+    VkPipeline* vkPipeline)
 {
-    LOGT("%p %p %p\n", device, pCreateInfo, pShader);
-    GrDevice* grDevice = (GrDevice*)device;
-    VkShaderModule vkShaderModule = VK_NULL_HANDLE;
-
-    if ((pCreateInfo->flags & GR_SHADER_CREATE_ALLOW_RE_Z) != 0) {
-        LOGW("unhandled Re-Z flag\n");
-    }
+    VkSpecializationInfo* specInfo = getVkSpecializationInfo(shader);
 
-    IlcShader ilcShader = ilcCompileShader(pCreateInfo->pCode, pCreateInfo->codeSize);
-
-    const VkShaderModuleCreateInfo createInfo = {
-        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+    const VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
         .pNext = NULL,
         .flags = 0,
-        .codeSize = ilcShader.codeSize,
-        .pCode = ilcShader.code,
+        .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+        .module = shaderModule,
+        .pName = "main",
+        .pSpecializationInfo = specInfo,
     };
 
-    VkResult res = VKD.vkCreateShaderModule(grDevice->device, &createInfo, NULL, &vkShaderModule);
-    if (res != VK_SUCCESS) {
-        LOGE("vkCreateShaderModule failed (%d)\n", res);
-        free(ilcShader.code);
-        return getGrResult(res);
-    }
-
-    free(ilcShader.code);
-
-    GrShader* grShader = malloc(sizeof(GrShader));
-    *grShader = (GrShader) {
-        .grObj = { GR_OBJ_TYPE_SHADER, grDevice },
-        .shaderModule = vkShaderModule,
-        .bindingCount = ilcShader.bindingCount,
-        .bindings = ilcShader.bindings,
+    const VkComputePipelineCreateInfo pipelineCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = (createFlags & GR_PIPELINE_CREATE_DISABLE_OPTIMIZATION) != 0 ?
+                 VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT : 0,
+        .stage = shaderStageCreateInfo,
+        .layout = pipelineLayout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = 0,
     };
 
-    *pShader = (GR_SHADER)grShader;
-    return GR_SUCCESS;
+    VkResult vkRes = VKD.vkCreateComputePipelines(grDevice->device, vkPipelineCache, 1,
+                                                  &pipelineCreateInfo, NULL, vkPipeline);
+    if (vkRes != VK_SUCCESS) {
+        LOGE("vkCreateComputePipelines failed (%d)\n", vkRes);
+    }
+
+    freeVkSpecializationInfo(specInfo);
+    return vkRes;
 }
 
-GR_RESULT grCreateGraphicsPipeline(
-    GR_DEVICE device,
+static GR_RESULT createGraphicsPipeline(
+    GrDevice* grDevice,
     const GR_GRAPHICS_PIPELINE_CREATE_INFO* pCreateInfo,
+    CompiledShader* const* loadedShaders,
     GR_PIPELINE* pPipeline)
 {
-    LOGT("%p %p %p\n", device, pCreateInfo, pPipeline);
-    GrDevice* grDevice = (GrDevice*)device;
     GR_RESULT res = GR_SUCCESS;
     VkDescriptorSetLayout descriptorSetLayouts[MAX_STAGE_COUNT] = { VK_NULL_HANDLE };
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkBuffer linkConstBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory linkConstMemory = VK_NULL_HANDLE;
+    DescriptorSetSlot* linkConstSlots[MAX_STAGE_COUNT] = { NULL };
 
     // TODO validate parameters
 
@@ -550,11 +828,11 @@ GR_RESULT grCreateGraphicsPipeline(
     // - tessState.optimalTessFactor (hint)
 
     Stage stages[MAX_STAGE_COUNT] = {
-        { &pCreateInfo->vs, VK_SHADER_STAGE_VERTEX_BIT },
-        { &pCreateInfo->hs, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT },
-        { &pCreateInfo->ds, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT },
-        { &pCreateInfo->gs, VK_SHADER_STAGE_GEOMETRY_BIT },
-        { &pCreateInfo->ps, VK_SHADER_STAGE_FRAGMENT_BIT },
+        { &pCreateInfo->vs, VK_SHADER_STAGE_VERTEX_BIT, NULL },
+        { &pCreateInfo->hs, VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT, NULL },
+        { &pCreateInfo->ds, VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT, NULL },
+        { &pCreateInfo->gs, VK_SHADER_STAGE_GEOMETRY_BIT, NULL },
+        { &pCreateInfo->ps, VK_SHADER_STAGE_FRAGMENT_BIT, NULL },
     };
 
     unsigned stageCount = 0;
@@ -563,25 +841,24 @@ GR_RESULT grCreateGraphicsPipeline(
     for (int i = 0; i < COUNT_OF(stages); i++) {
         Stage* stage = &stages[i];
 
-        if (stage->shader->shader == GR_NULL_HANDLE) {
+        stage->compiledShader = getStageCompiledShader(stage->shader, loadedShaders, i);
+        if (stage->compiledShader == NULL) {
             continue;
         }
 
-        if (stage->shader->linkConstBufferCount > 0) {
-            // TODO implement
-            LOGW("link-time constant buffers are not implemented\n");
+        res = shaderCompilerWait(grDevice->shaderCompiler, stage->compiledShader);
+        if (res != GR_SUCCESS) {
+            goto bail;
         }
 
-        GrShader* grShader = (GrShader*)stage->shader->shader;
-
         shaderStageCreateInfo[stageCount] = (VkPipelineShaderStageCreateInfo) {
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
             .pNext = NULL,
             .flags = 0,
             .stage = stage->flags,
-            .module = grShader->shaderModule,
+            .module = stage->compiledShader->shaderModule,
             .pName = "main",
-            .pSpecializationInfo = NULL,
+            .pSpecializationInfo = getVkSpecializationInfo(stage->shader),
         };
 
         stageCount++;
@@ -652,19 +929,40 @@ GR_RESULT grCreateGraphicsPipeline(
         goto bail;
     }
 
+    res = createLinkConstBuffer(grDevice, &linkConstBuffer, &linkConstMemory, linkConstSlots,
+                                COUNT_OF(stages), stages);
+    if (res != GR_SUCCESS) {
+        goto bail;
+    }
+
     GrPipeline* grPipeline = malloc(sizeof(GrPipeline));
     *grPipeline = (GrPipeline) {
         .grObj = { GR_OBJ_TYPE_PIPELINE, grDevice },
         .createInfo = pipelineCreateInfo,
-        .pipelineSlotCount = 0,
-        .pipelineSlots = NULL,
+        .createFlags = pCreateInfo->flags,
+        .iaState = pCreateInfo->iaState,
+        .tessState = pCreateInfo->tessState,
+        .rsState = pCreateInfo->rsState,
+        .cbState = pCreateInfo->cbState,
+        .dbState = pCreateInfo->dbState,
+        .pipelineSlots = { NULL },
+        .pendingPipelineSlots = NULL,
         .pipelineSlotsMutex = { 0 }, // Initialized below
+        .pipelineSlotsCond = CONDITION_VARIABLE_INIT,
+        .pipelineSlotCount = 0,
+        .storedData = NULL,
+        .storedDataSize = 0,
+        .storedSlotCount = 0,
         .pipelineLayout = pipelineLayout,
         .renderPass = renderPass,
         .descriptorTypeCounts = { 0 }, // Initialized below
         .stageCount = COUNT_OF(stages),
         .descriptorSetLayouts = { 0 }, // Initialized below
         .shaderInfos = { { 0 } }, // Initialized below
+        .compiledShaders = { NULL }, // Initialized below
+        .linkConstBuffer = linkConstBuffer,
+        .linkConstMemory = linkConstMemory,
+        .linkConstSlots = { NULL }, // Initialized below
     };
 
     InitializeCriticalSectionAndSpinCount(&grPipeline->pipelineSlotsMutex, 0);
@@ -673,12 +971,17 @@ GR_RESULT grCreateGraphicsPipeline(
     for (unsigned i = 0; i < COUNT_OF(stages); i++) {
         grPipeline->descriptorSetLayouts[i] = descriptorSetLayouts[i];
         copyPipelineShader(&grPipeline->shaderInfos[i], stages[i].shader);
+        grPipeline->compiledShaders[i] = getPipelineCompiledShader(grDevice, &stages[i]);
+        grPipeline->linkConstSlots[i] = linkConstSlots[i];
     }
 
     *pPipeline = (GR_PIPELINE)grPipeline;
     return GR_SUCCESS;
 
 bail:
+    for (unsigned i = 0; i < stageCount; i++) {
+        freeVkSpecializationInfo(shaderStageCreateInfo[i].pSpecializationInfo);
+    }
     for (unsigned i = 0; i < COUNT_OF(descriptorSetLayouts); i++) {
         VKD.vkDestroyDescriptorSetLayout(grDevice->device, descriptorSetLayouts[i], NULL);
     }
@@ -686,40 +989,34 @@ bail:
     return res;
 }
 
-GR_RESULT grCreateComputePipeline(
-    GR_DEVICE device,
+static GR_RESULT createComputePipeline(
+    GrDevice* grDevice,
     const GR_COMPUTE_PIPELINE_CREATE_INFO* pCreateInfo,
+    CompiledShader* const* loadedShaders,
+    VkPipelineCache vkPipelineCache,
     GR_PIPELINE* pPipeline)
 {
-    LOGT("%p %p %p\n", device, pCreateInfo, pPipeline);
-    GrDevice* grDevice = (GrDevice*)device;
     GR_RESULT res = GR_SUCCESS;
     VkResult vkRes;
     VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
     VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
     VkPipeline vkPipeline = VK_NULL_HANDLE;
+    VkBuffer linkConstBuffer = VK_NULL_HANDLE;
+    VkDeviceMemory linkConstMemory = VK_NULL_HANDLE;
+    DescriptorSetSlot* linkConstSlot = NULL;
 
     // TODO validate parameters
 
-    Stage stage = { &pCreateInfo->cs, VK_SHADER_STAGE_COMPUTE_BIT };
+    Stage stage = {
+        &pCreateInfo->cs, VK_SHADER_STAGE_COMPUTE_BIT,
+        getStageCompiledShader(&pCreateInfo->cs, loadedShaders, 0),
+    };
 
-    if (stage.shader->linkConstBufferCount > 0) {
-        // TODO implement
-        LOGW("link-time constant buffers are not implemented\n");
+    res = shaderCompilerWait(grDevice->shaderCompiler, stage.compiledShader);
+    if (res != GR_SUCCESS) {
+        goto bail;
     }
 
-    GrShader* grShader = (GrShader*)stage.shader->shader;
-
-    const VkPipelineShaderStageCreateInfo shaderStageCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = 0,
-        .stage = stage.flags,
-        .module = grShader->shaderModule,
-        .pName = "main",
-        .pSpecializationInfo = NULL,
-    };
-
     descriptorSetLayout = getVkDescriptorSetLayout(grDevice, &stage);
     if (descriptorSetLayout == VK_NULL_HANDLE) {
         res = GR_ERROR_OUT_OF_MEMORY;
@@ -732,50 +1029,68 @@ GR_RESULT grCreateComputePipeline(
         goto bail;
     }
 
-    const VkComputePipelineCreateInfo pipelineCreateInfo = {
-        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-        .pNext = NULL,
-        .flags = (pCreateInfo->flags & GR_PIPELINE_CREATE_DISABLE_OPTIMIZATION) != 0 ?
-                 VK_PIPELINE_CREATE_DISABLE_OPTIMIZATION_BIT : 0,
-        .stage = shaderStageCreateInfo,
-        .layout = pipelineLayout,
-        .basePipelineHandle = VK_NULL_HANDLE,
-        .basePipelineIndex = 0,
-    };
-
-    vkRes = VKD.vkCreateComputePipelines(grDevice->device, VK_NULL_HANDLE, 1, &pipelineCreateInfo,
-                                         NULL, &vkPipeline);
+    vkRes = createVkComputePipeline(grDevice, getPipelineCache(grDevice, vkPipelineCache),
+                                    pCreateInfo->flags, stage.shader,
+                                    stage.compiledShader->shaderModule, pipelineLayout,
+                                    &vkPipeline);
     if (vkRes != VK_SUCCESS) {
-        LOGE("vkCreateComputePipelines failed (%d)\n", vkRes);
         res = getGrResult(vkRes);
         goto bail;
     }
 
+    res = createLinkConstBuffer(grDevice, &linkConstBuffer, &linkConstMemory, &linkConstSlot,
+                                1, &stage);
+    if (res != GR_SUCCESS) {
+        VKD.vkDestroyPipeline(grDevice->device, vkPipeline, NULL);
+        goto bail;
+    }
+
+    // Compute pipelines have a single variant, looked up without state objects
     PipelineSlot* pipelineSlot = malloc(sizeof(PipelineSlot));
     *pipelineSlot = (PipelineSlot) {
         .pipeline = vkPipeline,
-        .grColorBlendState = NULL,
+        .result = VK_SUCCESS,
+        .hash = 0,
+        .blendStates = { { 0 } },
+        .polygonMode = 0,
+        .next = NULL,
     };
 
     GrPipeline* grPipeline = malloc(sizeof(GrPipeline));
     *grPipeline = (GrPipeline) {
         .grObj = { GR_OBJ_TYPE_PIPELINE, grDevice },
         .createInfo = NULL,
-        .pipelineSlotCount = 1,
-        .pipelineSlots = pipelineSlot,
+        .createFlags = pCreateInfo->flags,
+        .iaState = { 0 },
+        .tessState = { 0 },
+        .rsState = { 0 },
+        .cbState = { 0 },
+        .dbState = { 0 },
+        .pipelineSlots = { pipelineSlot },
+        .pendingPipelineSlots = NULL,
         .pipelineSlotsMutex = { 0 }, // Initialized below
+        .pipelineSlotsCond = CONDITION_VARIABLE_INIT,
+        .pipelineSlotCount = 1,
+        .storedData = NULL,
+        .storedDataSize = 0,
+        .storedSlotCount = 0,
         .pipelineLayout = pipelineLayout,
         .renderPass = VK_NULL_HANDLE,
         .descriptorTypeCounts = { 0 }, // Initialized below
         .stageCount = 1,
         .descriptorSetLayouts = { descriptorSetLayout },
         .shaderInfos = { { 0 } }, // Initialized below
+        .compiledShaders = { NULL }, // Initialized below
+        .linkConstBuffer = linkConstBuffer,
+        .linkConstMemory = linkConstMemory,
+        .linkConstSlots = { linkConstSlot },
     };
 
     InitializeCriticalSectionAndSpinCount(&grPipeline->pipelineSlotsMutex, 0);
     updateDescriptorTypeCounts(COUNT_OF(grPipeline->descriptorTypeCounts),
                                grPipeline->descriptorTypeCounts, 1, &stage);
     copyPipelineShader(&grPipeline->shaderInfos[0], stage.shader);
+    grPipeline->compiledShaders[0] = getPipelineCompiledShader(grDevice, &stage);
 
     *pPipeline = (GR_PIPELINE)grPipeline;
     return GR_SUCCESS;
@@ -785,3 +1100,875 @@ bail:
     VKD.vkDestroyPipelineLayout(grDevice->device, pipelineLayout, NULL);
     return res;
 }
+
+static void writePipelineData(
+    PipelineWriter* writer,
+    const void* data,
+    size_t size)
+{
+    if (writer->size + size > writer->capacity) {
+        writer->capacity = 2 * writer->capacity > writer->size + size ?
+                           2 * writer->capacity : writer->size + size;
+        writer->data = realloc(writer->data, writer->capacity);
+    }
+
+    if (size > 0) {
+        memcpy(&writer->data[writer->size], data, size);
+        writer->size += size;
+    }
+}
+
+static void writePipelineUint(
+    PipelineWriter* writer,
+    uint32_t value)
+{
+    writePipelineData(writer, &value, sizeof(value));
+}
+
+static void writeDescriptorSetMapping(
+    PipelineWriter* writer,
+    const GR_DESCRIPTOR_SET_MAPPING* mapping)
+{
+    writePipelineUint(writer, mapping->descriptorCount);
+
+    for (unsigned i = 0; i < mapping->descriptorCount; i++) {
+        const GR_DESCRIPTOR_SLOT_INFO* slotInfo = &mapping->pDescriptorInfo[i];
+
+        writePipelineUint(writer, slotInfo->slotObjectType);
+        if (slotInfo->slotObjectType == GR_SLOT_NEXT_DESCRIPTOR_SET) {
+            writeDescriptorSetMapping(writer, slotInfo->pNextLevelSet);
+        } else {
+            writePipelineUint(writer, slotInfo->shaderEntityIndex);
+        }
+    }
+}
+
+static void writePipelineShader(
+    PipelineWriter* writer,
+    const GR_PIPELINE_SHADER* shader,
+    const CompiledShader* compiledShader)
+{
+    writePipelineUint(writer, compiledShader != NULL);
+    if (compiledShader == NULL) {
+        return;
+    }
+
+    // The IL code identifies the shader, the SPIR-V code skips compilation on load
+    writePipelineUint(writer, compiledShader->codeSize);
+    writePipelineData(writer, compiledShader->code, compiledShader->codeSize);
+    writePipelineUint(writer, compiledShader->spirvSize);
+    writePipelineData(writer, compiledShader->spirvCode, compiledShader->spirvSize);
+    writePipelineUint(writer, compiledShader->bindingCount);
+    for (unsigned i = 0; i < compiledShader->bindingCount; i++) {
+        writePipelineUint(writer, compiledShader->bindings[i].index);
+        writePipelineUint(writer, compiledShader->bindings[i].descriptorType);
+    }
+
+    for (unsigned i = 0; i < COUNT_OF(shader->descriptorSetMapping); i++) {
+        writeDescriptorSetMapping(writer, &shader->descriptorSetMapping[i]);
+    }
+
+    writePipelineUint(writer, shader->linkConstBufferCount);
+    for (unsigned i = 0; i < shader->linkConstBufferCount; i++) {
+        const GR_LINK_CONST_BUFFER* linkConstBuffer = &shader->pLinkConstBufferInfo[i];
+
+        writePipelineUint(writer, linkConstBuffer->bufferId);
+        writePipelineUint(writer, linkConstBuffer->bufferSize);
+        writePipelineData(writer, linkConstBuffer->pBufferData, linkConstBuffer->bufferSize);
+    }
+
+    writePipelineUint(writer, shader->dynamicMemoryViewMapping.slotObjectType);
+    writePipelineUint(writer, shader->dynamicMemoryViewMapping.shaderEntityIndex);
+}
+
+static void writePipelineSlotKeys(
+    PipelineWriter* writer,
+    PipelineSlot* const* pipelineSlots)
+{
+    uint32_t slotCount = 0;
+
+    for (unsigned i = 0; i < PIPELINE_SLOT_BUCKET_COUNT; i++) {
+        for (const PipelineSlot* slot = pipelineSlots[i]; slot != NULL; slot = slot->next) {
+            slotCount += slot->result == VK_SUCCESS;
+        }
+    }
+
+    // Only the states are stored, the variants are recreated from the cache data on load
+    writePipelineUint(writer, slotCount);
+    for (unsigned i = 0; i < PIPELINE_SLOT_BUCKET_COUNT; i++) {
+        for (const PipelineSlot* slot = pipelineSlots[i]; slot != NULL; slot = slot->next) {
+            if (slot->result == VK_SUCCESS) {
+                writePipelineData(writer, &slot->hash, sizeof(slot->hash));
+                writePipelineUint(writer, slot->polygonMode);
+                writePipelineData(writer, slot->blendStates, sizeof(slot->blendStates));
+            }
+        }
+    }
+}
+
+static void writePipelineCacheData(
+    PipelineWriter* writer,
+    GrPipeline* grPipeline,
+    PipelineSlot* const* pipelineSlots)
+{
+    const GrDevice* grDevice = GET_OBJ_DEVICE(grPipeline);
+    size_t size = 0;
+    void* data = NULL;
+
+    VkPipelineCache vkPipelineCache = pipelineCacheCreate(grDevice, NULL, 0);
+    if (vkPipelineCache == VK_NULL_HANDLE) {
+        writePipelineUint(writer, 0);
+        return;
+    }
+
+    // Recreate the variants into an empty cache so that only this pipeline gets stored.
+    // Drivers usually hit their internal caches, making this cheap.
+    for (unsigned i = 0; i < PIPELINE_SLOT_BUCKET_COUNT; i++) {
+        for (const PipelineSlot* slot = pipelineSlots[i]; slot != NULL; slot = slot->next) {
+            VkPipeline vkPipeline = VK_NULL_HANDLE;
+
+            if (grPipeline->createInfo != NULL) {
+                getVkPipeline(grPipeline, vkPipelineCache, slot->blendStates, slot->polygonMode,
+                              &vkPipeline);
+            } else {
+                createVkComputePipeline(grDevice, vkPipelineCache, grPipeline->createFlags,
+                                        &grPipeline->shaderInfos[0],
+                                        grPipeline->compiledShaders[0]->shaderModule,
+                                        grPipeline->pipelineLayout, &vkPipeline);
+            }
+
+            VKD.vkDestroyPipeline(grDevice->device, vkPipeline, NULL);
+        }
+    }
+
+    VkResult vkRes = VKD.vkGetPipelineCacheData(grDevice->device, vkPipelineCache, &size, NULL);
+    if (vkRes == VK_SUCCESS) {
+        data = malloc(size);
+        vkRes = VKD.vkGetPipelineCacheData(grDevice->device, vkPipelineCache, &size, data);
+    }
+    if (vkRes != VK_SUCCESS) {
+        LOGE("vkGetPipelineCacheData failed (%d)\n", vkRes);
+        size = 0;
+    }
+
+    writePipelineUint(writer, size);
+    writePipelineData(writer, data, size);
+
+    free(data);
+    VKD.vkDestroyPipelineCache(grDevice->device, vkPipelineCache, NULL);
+}
+
+static void writePipeline(
+    PipelineWriter* writer,
+    GrPipeline* grPipeline,
+    PipelineSlot* const* pipelineSlots)
+{
+    bool isCompute = grPipeline->createInfo == NULL;
+
+    PipelineDataHeader header = {
+        .magic = PIPELINE_DATA_MAGIC,
+        .version = PIPELINE_DATA_VERSION,
+        .grvkVersion = { 0 }, // Initialized below
+        .isCompute = isCompute,
+    };
+
+    strncpy(header.grvkVersion, GRVK_VERSION, sizeof(header.grvkVersion) - 1);
+
+    writePipelineData(writer, &header, sizeof(header));
+    writePipelineUint(writer, grPipeline->createFlags);
+    if (!isCompute) {
+        writePipelineData(writer, &grPipeline->iaState, sizeof(grPipeline->iaState));
+        writePipelineData(writer, &grPipeline->tessState, sizeof(grPipeline->tessState));
+        writePipelineData(writer, &grPipeline->rsState, sizeof(grPipeline->rsState));
+        writePipelineData(writer, &grPipeline->cbState, sizeof(grPipeline->cbState));
+        writePipelineData(writer, &grPipeline->dbState, sizeof(grPipeline->dbState));
+    }
+
+    for (unsigned i = 0; i < grPipeline->stageCount; i++) {
+        writePipelineShader(writer, &grPipeline->shaderInfos[i], grPipeline->compiledShaders[i]);
+    }
+
+    if (!isCompute) {
+        writePipelineSlotKeys(writer, pipelineSlots);
+    }
+    writePipelineCacheData(writer, grPipeline, pipelineSlots);
+}
+
+static const void* readPipelineData(
+    PipelineReader* reader,
+    size_t size)
+{
+    if (size > reader->size - reader->offset) {
+        return NULL;
+    }
+
+    const void* data = &reader->data[reader->offset];
+    reader->offset += size;
+    return data;
+}
+
+static bool readPipelineUint(
+    PipelineReader* reader,
+    uint32_t* value)
+{
+    const void* data = readPipelineData(reader, sizeof(*value));
+
+    if (data == NULL) {
+        return false;
+    }
+
+    memcpy(value, data, sizeof(*value));
+    return true;
+}
+
+static bool readPipelineStruct(
+    PipelineReader* reader,
+    void* value,
+    size_t size)
+{
+    const void* data = readPipelineData(reader, size);
+
+    if (data == NULL) {
+        return false;
+    }
+
+    memcpy(value, data, size);
+    return true;
+}
+
+static bool readDescriptorSetMapping(
+    PipelineReader* reader,
+    GR_DESCRIPTOR_SET_MAPPING* mapping,
+    unsigned depth)
+{
+    uint32_t descriptorCount;
+
+    *mapping = (GR_DESCRIPTOR_SET_MAPPING) {
+        .descriptorCount = 0,
+        .pDescriptorInfo = NULL,
+    };
+
+    if (depth >= MAX_DESCRIPTOR_SET_DEPTH) {
+        LOGW("descriptor sets nested deeper than %d levels\n", MAX_DESCRIPTOR_SET_DEPTH);
+        return false;
+    }
+
+    // Each slot takes at least two dwords, reject counts the data can't hold
+    if (!readPipelineUint(reader, &descriptorCount) ||
+        descriptorCount > (reader->size - reader->offset) / (2 * sizeof(uint32_t))) {
+        return false;
+    }
+
+    GR_DESCRIPTOR_SLOT_INFO* slotInfos = calloc(descriptorCount, sizeof(GR_DESCRIPTOR_SLOT_INFO));
+    mapping->pDescriptorInfo = slotInfos;
+
+    for (unsigned i = 0; i < descriptorCount; i++) {
+        GR_DESCRIPTOR_SLOT_INFO* slotInfo = &slotInfos[i];
+
+        // Partially read mappings get freed up to this slot
+        mapping->descriptorCount = i + 1;
+
+        if (!readPipelineUint(reader, &slotInfo->slotObjectType)) {
+            return false;
+        }
+
+        if (slotInfo->slotObjectType == GR_SLOT_NEXT_DESCRIPTOR_SET) {
+            GR_DESCRIPTOR_SET_MAPPING* nextLevelSet = malloc(sizeof(GR_DESCRIPTOR_SET_MAPPING));
+
+            slotInfo->pNextLevelSet = nextLevelSet;
+            if (!readDescriptorSetMapping(reader, nextLevelSet, depth + 1)) {
+                return false;
+            }
+        } else if (!readPipelineUint(reader, &slotInfo->shaderEntityIndex)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void freePipelineShader(
+    const GrDevice* grDevice,
+    const GR_PIPELINE_SHADER* shader,
+    CompiledShader* compiledShader)
+{
+    for (unsigned i = 0; i < COUNT_OF(shader->descriptorSetMapping); i++) {
+        freeDescriptorSetMapping(&shader->descriptorSetMapping[i]);
+    }
+
+    // Link constant data points into the pipeline data
+    free((void*)shader->pLinkConstBufferInfo);
+
+    if (compiledShader != NULL) {
+        shaderCompilerRelease(grDevice->shaderCompiler, compiledShader);
+    }
+}
+
+static bool readPipelineShader(
+    PipelineReader* reader,
+    GrDevice* grDevice,
+    GR_PIPELINE_SHADER* shader,
+    CompiledShader** compiledShader)
+{
+    uint32_t hasShader;
+    uint32_t codeSize;
+    const void* code;
+    uint32_t spirvSize;
+    const void* spirvCode;
+    uint32_t bindingCount;
+    IlcBinding* bindings = NULL;
+    uint32_t linkConstBufferCount;
+
+    // Loaded shaders have no shader object, the pipeline gets the compiled shader directly
+    *shader = (GR_PIPELINE_SHADER) { 0 };
+    *compiledShader = NULL;
+
+    if (!readPipelineUint(reader, &hasShader)) {
+        return false;
+    } else if (!hasShader) {
+        return true;
+    }
+
+    if (!readPipelineUint(reader, &codeSize) ||
+        (code = readPipelineData(reader, codeSize)) == NULL ||
+        !readPipelineUint(reader, &spirvSize) || (spirvSize % sizeof(uint32_t)) != 0 ||
+        (spirvCode = readPipelineData(reader, spirvSize)) == NULL ||
+        !readPipelineUint(reader, &bindingCount) ||
+        bindingCount > (reader->size - reader->offset) / (2 * sizeof(uint32_t))) {
+        return false;
+    }
+
+    bindings = malloc(bindingCount * sizeof(IlcBinding));
+    for (unsigned i = 0; i < bindingCount; i++) {
+        uint32_t descriptorType;
+
+        readPipelineUint(reader, &bindings[i].index);
+        readPipelineUint(reader, &descriptorType);
+        bindings[i].descriptorType = descriptorType;
+    }
+
+    // Identical shaders are shared, others get their module created from the stored SPIR-V
+    *compiledShader = shaderCompilerLoad(grDevice->shaderCompiler, code, codeSize,
+                                         spirvCode, spirvSize, bindings, bindingCount);
+    free(bindings);
+
+    for (unsigned i = 0; i < COUNT_OF(shader->descriptorSetMapping); i++) {
+        if (!readDescriptorSetMapping(reader, &shader->descriptorSetMapping[i], 0)) {
+            return false;
+        }
+    }
+
+    if (!readPipelineUint(reader, &linkConstBufferCount) ||
+        linkConstBufferCount > (reader->size - reader->offset) / (2 * sizeof(uint32_t))) {
+        return false;
+    }
+
+    GR_LINK_CONST_BUFFER* linkConstBuffers = calloc(linkConstBufferCount,
+                                                    sizeof(GR_LINK_CONST_BUFFER));
+    shader->pLinkConstBufferInfo = linkConstBuffers;
+
+    for (unsigned i = 0; i < linkConstBufferCount; i++) {
+        GR_LINK_CONST_BUFFER* linkConstBuffer = &linkConstBuffers[i];
+        uint32_t bufferSize;
+
+        if (!readPipelineUint(reader, &linkConstBuffer->bufferId) ||
+            !readPipelineUint(reader, &bufferSize) ||
+            (linkConstBuffer->pBufferData = readPipelineData(reader, bufferSize)) == NULL) {
+            return false;
+        }
+
+        linkConstBuffer->bufferSize = bufferSize;
+    }
+
+    shader->linkConstBufferCount = linkConstBufferCount;
+
+    return readPipelineUint(reader, &shader->dynamicMemoryViewMapping.slotObjectType) &&
+           readPipelineUint(reader, &shader->dynamicMemoryViewMapping.shaderEntityIndex);
+}
+
+static bool readPipelineSlotKeys(
+    PipelineReader* reader,
+    PipelineSlot** slotKeys,
+    uint32_t* slotKeyCount)
+{
+    const size_t keySize = sizeof((*slotKeys)->hash) + sizeof(uint32_t) +
+                           sizeof((*slotKeys)->blendStates);
+    uint32_t count = 0;
+
+    if (!readPipelineUint(reader, &count) || count > (reader->size - reader->offset) / keySize) {
+        return false;
+    }
+
+    PipelineSlot* keys = malloc(count * sizeof(PipelineSlot));
+
+    for (unsigned i = 0; i < count; i++) {
+        uint32_t polygonMode = 0;
+
+        keys[i] = (PipelineSlot) {
+            .pipeline = VK_NULL_HANDLE,
+            .result = VK_NOT_READY,
+            .hash = 0, // Initialized below
+            .blendStates = { { 0 } }, // Initialized below
+            .polygonMode = 0, // Initialized below
+            .next = NULL,
+        };
+
+        if (!readPipelineStruct(reader, &keys[i].hash, sizeof(keys[i].hash)) ||
+            !readPipelineUint(reader, &polygonMode) ||
+            !readPipelineStruct(reader, keys[i].blendStates, sizeof(keys[i].blendStates))) {
+            free(keys);
+            return false;
+        }
+
+        keys[i].polygonMode = polygonMode;
+    }
+
+    *slotKeys = keys;
+    *slotKeyCount = count;
+    return true;
+}
+
+static void createLoadedPipelineSlots(
+    GrPipeline* grPipeline,
+    VkPipelineCache vkPipelineCache,
+    const PipelineSlot* slotKeys,
+    unsigned slotKeyCount)
+{
+    // The pipeline isn't published yet, no locking needed
+    for (unsigned i = 0; i < slotKeyCount; i++) {
+        const PipelineSlot* key = &slotKeys[i];
+        PipelineSlot* volatile* bucket =
+            &grPipeline->pipelineSlots[key->hash % PIPELINE_SLOT_BUCKET_COUNT];
+
+        if (findPipelineSlot(*bucket, key->hash, key->blendStates, key->polygonMode) != NULL) {
+            continue;
+        }
+
+        VkPipeline vkPipeline = VK_NULL_HANDLE;
+        VkResult vkRes = getVkPipeline(grPipeline, vkPipelineCache, key->blendStates,
+                                       key->polygonMode, &vkPipeline);
+        if (vkRes != VK_SUCCESS) {
+            // Left to be created on first use
+            continue;
+        }
+
+        PipelineSlot* slot = malloc(sizeof(PipelineSlot));
+        *slot = *key;
+        slot->pipeline = vkPipeline;
+        slot->result = VK_SUCCESS;
+        slot->next = *bucket;
+        *bucket = slot;
+        grPipeline->pipelineSlotCount++;
+    }
+}
+
+// Exported Functions
+
+void grPipelineCreateVkPipeline(
+    GrPipeline* grPipeline,
+    PipelineSlot* pipelineSlot)
+{
+    const GrDevice* grDevice = GET_OBJ_DEVICE(grPipeline);
+    PipelineSlot* volatile* bucket =
+        &grPipeline->pipelineSlots[pipelineSlot->hash % PIPELINE_SLOT_BUCKET_COUNT];
+
+    // Other variants of the pipeline can be created concurrently
+    pipelineSlot->result = getVkPipeline(grPipeline, grDevice->pipelineCache,
+                                         pipelineSlot->blendStates, pipelineSlot->polygonMode,
+                                         &pipelineSlot->pipeline);
+
+    EnterCriticalSection(&grPipeline->pipelineSlotsMutex);
+
+    PipelineSlot** pendingSlot = &grPipeline->pendingPipelineSlots;
+    while (*pendingSlot != pipelineSlot) {
+        pendingSlot = &(*pendingSlot)->next;
+    }
+    *pendingSlot = pipelineSlot->next;
+
+    // Publish the slot once fully written, failed variants keep their error to avoid retrying
+    pipelineSlot->next = *bucket;
+    InterlockedExchangePointer((PVOID volatile*)bucket, pipelineSlot);
+    grPipeline->pipelineSlotCount++;
+
+    WakeAllConditionVariable(&grPipeline->pipelineSlotsCond);
+    LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+}
+
+VkResult grPipelineFindOrCreateVkPipeline(
+    GrPipeline* grPipeline,
+    const GrColorBlendStateObject* grColorBlendState,
+    const GrRasterStateObject* grRasterState,
+    VkPipeline* vkPipeline)
+{
+    static const VkPipelineColorBlendAttachmentState noBlendStates[GR_MAX_COLOR_TARGETS];
+    const GrDevice* grDevice = GET_OBJ_DEVICE(grPipeline);
+
+    if (grDevice->hasExtendedDynamicState3) {
+        // Set at draw time, a single variant covers all states
+        grColorBlendState = NULL;
+        grRasterState = NULL;
+    }
+
+    const VkPipelineColorBlendAttachmentState* blendStates =
+        grColorBlendState != NULL ? grColorBlendState->states : noBlendStates;
+    VkPolygonMode polygonMode = grRasterState != NULL ? grRasterState->polygonMode : 0;
+    uint64_t hash = (grColorBlendState != NULL ? grColorBlendState->statesHash : 0) ^ polygonMode;
+    PipelineSlot* volatile* bucket = &grPipeline->pipelineSlots[hash % PIPELINE_SLOT_BUCKET_COUNT];
+
+    // Published slots are immutable, look them up without locking
+    const PipelineSlot* slot = findPipelineSlot(*bucket, hash, blendStates, polygonMode);
+    if (slot != NULL) {
+        *vkPipeline = slot->pipeline;
+        return slot->result;
+    }
+
+    bool isAsync = grDevice->isAsyncPipelinesEnabled;
+    DWORD timeout = isAsync ? grDevice->asyncPipelineTimeout : INFINITE;
+    ULONGLONG deadline = GetTickCount64() + timeout;
+
+    EnterCriticalSection(&grPipeline->pipelineSlotsMutex);
+
+    bool isPending = false;
+    while ((slot = findPipelineSlot(*bucket, hash, blendStates, polygonMode)) == NULL) {
+        if (!isPending) {
+            isPending = findPipelineSlot(grPipeline->pendingPipelineSlots, hash, blendStates,
+                                         polygonMode) != NULL;
+        }
+
+        if (!isPending) {
+            PipelineSlot* newSlot = malloc(sizeof(PipelineSlot));
+            *newSlot = (PipelineSlot) {
+                .pipeline = VK_NULL_HANDLE, // Initialized on creation
+                .result = VK_NOT_READY, // Initialized on creation
+                .hash = hash,
+                .blendStates = { { 0 } }, // Initialized below
+                .polygonMode = polygonMode,
+                .next = grPipeline->pendingPipelineSlots,
+            };
+
+            memcpy(newSlot->blendStates, blendStates, sizeof(newSlot->blendStates));
+            grPipeline->pendingPipelineSlots = newSlot;
+            isPending = true;
+
+            if (!isAsync ||
+                !shaderCompilerSubmitPipeline(grDevice->shaderCompiler, grPipeline, newSlot)) {
+                LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+                grPipelineCreateVkPipeline(grPipeline, newSlot);
+                *vkPipeline = newSlot->pipeline;
+                return newSlot->result;
+            }
+        }
+
+        // Wait for the thread creating the variant, give up after the timeout if one is set
+        DWORD waitTime = INFINITE;
+        if (timeout != INFINITE) {
+            ULONGLONG time = GetTickCount64();
+            if (time >= deadline) {
+                break;
+            }
+
+            waitTime = (DWORD)(deadline - time);
+        }
+
+        SleepConditionVariableCS(&grPipeline->pipelineSlotsCond, &grPipeline->pipelineSlotsMutex,
+                                 waitTime);
+    }
+
+    LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+
+    // Still being created in the background
+    if (slot == NULL) {
+        *vkPipeline = VK_NULL_HANDLE;
+        return VK_NOT_READY;
+    }
+
+    *vkPipeline = slot->pipeline;
+    return slot->result;
+}
+
+void grPipelineDestroyResources(
+    GrPipeline* grPipeline)
+{
+    const GrDevice* grDevice = GET_OBJ_DEVICE(grPipeline);
+
+    // Background jobs still refer to the pipeline
+    EnterCriticalSection(&grPipeline->pipelineSlotsMutex);
+    while (grPipeline->pendingPipelineSlots != NULL) {
+        SleepConditionVariableCS(&grPipeline->pipelineSlotsCond, &grPipeline->pipelineSlotsMutex,
+                                 INFINITE);
+    }
+    LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+
+    for (unsigned i = 0; i < PIPELINE_SLOT_BUCKET_COUNT; i++) {
+        PipelineSlot* slot = grPipeline->pipelineSlots[i];
+
+        while (slot != NULL) {
+            PipelineSlot* next = slot->next;
+
+            VKD.vkDestroyPipeline(grDevice->device, slot->pipeline, NULL);
+            free(slot);
+            slot = next;
+        }
+    }
+
+    const PipelineCreateInfo* createInfo = grPipeline->createInfo;
+    if (createInfo != NULL) {
+        for (unsigned i = 0; i < createInfo->stageCount; i++) {
+            freeVkSpecializationInfo(createInfo->stageCreateInfos[i].pSpecializationInfo);
+        }
+        free(grPipeline->createInfo);
+    }
+
+    for (unsigned i = 0; i < grPipeline->stageCount; i++) {
+        VKD.vkDestroyDescriptorSetLayout(grDevice->device, grPipeline->descriptorSetLayouts[i],
+                                         NULL);
+        freePipelineShaderCopy(&grPipeline->shaderInfos[i]);
+        if (grPipeline->compiledShaders[i] != NULL) {
+            shaderCompilerRelease(grDevice->shaderCompiler, grPipeline->compiledShaders[i]);
+        }
+        free(grPipeline->linkConstSlots[i]);
+    }
+
+    VKD.vkDestroyPipelineLayout(grDevice->device, grPipeline->pipelineLayout, NULL);
+    VKD.vkDestroyRenderPass(grDevice->device, grPipeline->renderPass, NULL);
+    VKD.vkDestroyBuffer(grDevice->device, grPipeline->linkConstBuffer, NULL);
+    VKD.vkFreeMemory(grDevice->device, grPipeline->linkConstMemory, NULL);
+    free(grPipeline->storedData);
+    DeleteCriticalSection(&grPipeline->pipelineSlotsMutex);
+}
+
+// Shader and Pipeline Functions
+
+GR_RESULT grCreateShader(
+    GR_DEVICE device,
+    const GR_SHADER_CREATE_INFO* pCreateInfo,
+    GR_SHADER* pShader)
+{
+    LOGT("%p %p %p\n", device, pCreateInfo, pShader);
+    GrDevice* grDevice = (GrDevice*)device;
+
+    if ((pCreateInfo->flags & GR_SHADER_CREATE_ALLOW_RE_Z) != 0) {
+        LOGW("unhandled Re-Z flag\n");
+    }
+
+    // Compilation is deferred to the worker threads, pipeline creation waits for completion
+    GrShader* grShader = malloc(sizeof(GrShader));
+    *grShader = (GrShader) {
+        .grObj = { GR_OBJ_TYPE_SHADER, grDevice },
+        .compiledShader = shaderCompilerSubmit(grDevice->shaderCompiler, pCreateInfo->pCode,
+                                               pCreateInfo->codeSize),
+    };
+
+    *pShader = (GR_SHADER)grShader;
+    return GR_SUCCESS;
+}
+
+GR_RESULT grCreateGraphicsPipeline(
+    GR_DEVICE device,
+    const GR_GRAPHICS_PIPELINE_CREATE_INFO* pCreateInfo,
+    GR_PIPELINE* pPipeline)
+{
+    LOGT("%p %p %p\n", device, pCreateInfo, pPipeline);
+    GrDevice* grDevice = (GrDevice*)device;
+
+    return createGraphicsPipeline(grDevice, pCreateInfo, NULL, pPipeline);
+}
+
+GR_RESULT grCreateComputePipeline(
+    GR_DEVICE device,
+    const GR_COMPUTE_PIPELINE_CREATE_INFO* pCreateInfo,
+    GR_PIPELINE* pPipeline)
+{
+    LOGT("%p %p %p\n", device, pCreateInfo, pPipeline);
+    GrDevice* grDevice = (GrDevice*)device;
+
+    return createComputePipeline(grDevice, pCreateInfo, NULL, VK_NULL_HANDLE, pPipeline);
+}
+
+GR_RESULT grStorePipeline(
+    GR_PIPELINE pipeline,
+    GR_SIZE* pDataSize,
+    GR_VOID* pData)
+{
+    LOGT("%p %p %p\n", pipeline, pDataSize, pData);
+    GrPipeline* grPipeline = (GrPipeline*)pipeline;
+
+    if (grPipeline == NULL) {
+        return GR_ERROR_INVALID_HANDLE;
+    } else if (GET_OBJ_TYPE(grPipeline) != GR_OBJ_TYPE_PIPELINE) {
+        return GR_ERROR_INVALID_OBJECT_TYPE;
+    } else if (pDataSize == NULL) {
+        return GR_ERROR_INVALID_POINTER;
+    }
+
+    EnterCriticalSection(&grPipeline->pipelineSlotsMutex);
+
+    // Applications query the size first, build the data once for both calls
+    if (grPipeline->storedData == NULL ||
+        grPipeline->storedSlotCount != grPipeline->pipelineSlotCount) {
+        PipelineSlot* pipelineSlots[PIPELINE_SLOT_BUCKET_COUNT];
+        unsigned slotCount = grPipeline->pipelineSlotCount;
+        PipelineWriter writer = {
+            .data = NULL,
+            .size = 0,
+            .capacity = 0,
+        };
+
+        // Published lists only grow at their head, so copying the heads is a consistent snapshot.
+        // Recreating the variants is slow, don't block draws creating new ones meanwhile.
+        for (unsigned i = 0; i < PIPELINE_SLOT_BUCKET_COUNT; i++) {
+            pipelineSlots[i] = grPipeline->pipelineSlots[i];
+        }
+
+        LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+        writePipeline(&writer, grPipeline, pipelineSlots);
+        EnterCriticalSection(&grPipeline->pipelineSlotsMutex);
+
+        // Keep the most complete data if another thread stored the pipeline concurrently
+        if (grPipeline->storedData == NULL || grPipeline->storedSlotCount < slotCount) {
+            free(grPipeline->storedData);
+            grPipeline->storedData = writer.data;
+            grPipeline->storedDataSize = writer.size;
+            grPipeline->storedSlotCount = slotCount;
+        } else {
+            free(writer.data);
+        }
+    }
+
+    if (pData != NULL && *pDataSize < grPipeline->storedDataSize) {
+        LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+        return GR_ERROR_INVALID_MEMORY_SIZE;
+    }
+
+    *pDataSize = grPipeline->storedDataSize;
+
+    if (pData != NULL) {
+        memcpy(pData, grPipeline->storedData, grPipeline->storedDataSize);
+    }
+
+    LeaveCriticalSection(&grPipeline->pipelineSlotsMutex);
+    return GR_SUCCESS;
+}
+
+GR_RESULT grLoadPipeline(
+    GR_DEVICE device,
+    GR_SIZE dataSize,
+    const GR_VOID* pData,
+    GR_PIPELINE* pPipeline)
+{
+    LOGT("%p %llu %p %p\n", device, (unsigned long long)dataSize, pData, pPipeline);
+    GrDevice* grDevice = (GrDevice*)device;
+    GR_RESULT res = GR_SUCCESS;
+    PipelineDataHeader header;
+    GR_FLAGS flags = 0;
+    GR_PIPELINE_IA_STATE iaState;
+    GR_PIPELINE_TESS_STATE tessState;
+    GR_PIPELINE_RS_STATE rsState;
+    GR_PIPELINE_CB_STATE cbState;
+    GR_PIPELINE_DB_STATE dbState;
+    GR_PIPELINE_SHADER shaders[MAX_STAGE_COUNT];
+    CompiledShader* compiledShaders[MAX_STAGE_COUNT];
+    unsigned shaderCount = 0;
+    PipelineSlot* slotKeys = NULL;
+    uint32_t slotKeyCount = 0;
+    uint32_t cacheDataSize = 0;
+    const void* cacheData = NULL;
+    VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+
+    if (grDevice == NULL) {
+        return GR_ERROR_INVALID_HANDLE;
+    } else if (GET_OBJ_TYPE(grDevice) != GR_OBJ_TYPE_DEVICE) {
+        return GR_ERROR_INVALID_OBJECT_TYPE;
+    } else if (pData == NULL || pPipeline == NULL) {
+        return GR_ERROR_INVALID_POINTER;
+    }
+
+    PipelineReader reader = {
+        .data = pData,
+        .size = dataSize,
+        .offset = 0,
+    };
+
+    if (!readPipelineStruct(&reader, &header, sizeof(header)) ||
+        header.magic != PIPELINE_DATA_MAGIC) {
+        return GR_ERROR_BAD_PIPELINE_DATA;
+    } else if (header.version != PIPELINE_DATA_VERSION ||
+               strncmp(header.grvkVersion, GRVK_VERSION, sizeof(header.grvkVersion) - 1) != 0) {
+        LOGW("pipeline data was stored by another version\n");
+        return GR_ERROR_INCOMPATIBLE_DRIVER;
+    }
+
+    bool isValid = readPipelineUint(&reader, &flags);
+
+    if (isValid && !header.isCompute) {
+        isValid = readPipelineStruct(&reader, &iaState, sizeof(iaState)) &&
+                  readPipelineStruct(&reader, &tessState, sizeof(tessState)) &&
+                  readPipelineStruct(&reader, &rsState, sizeof(rsState)) &&
+                  readPipelineStruct(&reader, &cbState, sizeof(cbState)) &&
+                  readPipelineStruct(&reader, &dbState, sizeof(dbState));
+    }
+
+    // Shaders are restored from their SPIR-V code, skipping IL compilation
+    for (unsigned i = 0; isValid && i < (header.isCompute ? 1 : MAX_STAGE_COUNT); i++) {
+        isValid = readPipelineShader(&reader, grDevice, &shaders[i], &compiledShaders[i]);
+        shaderCount++;
+    }
+
+    if (isValid && !header.isCompute) {
+        isValid = readPipelineSlotKeys(&reader, &slotKeys, &slotKeyCount);
+    }
+
+    isValid = isValid && readPipelineUint(&reader, &cacheDataSize) &&
+              (cacheData = readPipelineData(&reader, cacheDataSize)) != NULL;
+
+    if (!isValid) {
+        LOGW("corrupted pipeline data\n");
+        res = GR_ERROR_BAD_PIPELINE_DATA;
+        goto bail;
+    }
+
+    // Incompatible cache data is ignored by the Vulkan driver. The cache is only used to create
+    // the stored variants, later ones go into the device cache.
+    vkPipelineCache = pipelineCacheCreate(grDevice, cacheData, cacheDataSize);
+
+    if (header.isCompute) {
+        const GR_COMPUTE_PIPELINE_CREATE_INFO createInfo = {
+            .cs = shaders[0],
+            .flags = flags,
+        };
+
+        res = createComputePipeline(grDevice, &createInfo, compiledShaders, vkPipelineCache,
+                                    pPipeline);
+    } else {
+        const GR_GRAPHICS_PIPELINE_CREATE_INFO createInfo = {
+            .vs = shaders[0],
+            .hs = shaders[1],
+            .ds = shaders[2],
+            .gs = shaders[3],
+            .ps = shaders[4],
+            .iaState = iaState,
+            .tessState = tessState,
+            .rsState = rsState,
+            .cbState = cbState,
+            .dbState = dbState,
+            .flags = flags,
+        };
+
+        res = createGraphicsPipeline(grDevice, &createInfo, compiledShaders, pPipeline);
+        if (res == GR_SUCCESS) {
+            createLoadedPipelineSlots((GrPipeline*)*pPipeline, vkPipelineCache, slotKeys,
+                                      slotKeyCount);
+        }
+    }
+
+    VKD.vkDestroyPipelineCache(grDevice->device, vkPipelineCache, NULL);
+
+bail:
+    // The pipeline holds its own references and copies
+    for (unsigned i = 0; i < shaderCount; i++) {
+        freePipelineShader(grDevice, &shaders[i], compiledShaders[i]);
+    }
+    free(slotKeys);
+
+    return res;
+}
@@ -133,6 +133,7 @@ GR_RESULT grCreateColorBlendState(
     *grColorBlendStateObject = (GrColorBlendStateObject) {
         .grObj = { GR_OBJ_TYPE_COLOR_BLEND_STATE_OBJECT, grDevice },
         .states = { { 0 } }, // Initialized below
+        .statesHash = 0, // Initialized below
         .blendConstants = {
             pCreateInfo->blendConst[0], pCreateInfo->blendConst[1],
             pCreateInfo->blendConst[2], pCreateInfo->blendConst[3],
@@ -167,6 +168,10 @@ GR_RESULT grCreateColorBlendState(
         }
     }
 
+    // Ignored fields are zeroed, identical states hash the same
+    grColorBlendStateObject->statesHash = getHash(grColorBlendStateObject->states,
+                                                  sizeof(grColorBlendStateObject->states));
+
     *pState = (GR_COLOR_BLEND_STATE_OBJECT)grColorBlendStateObject;
     return GR_SUCCESS;
 }
@@ -500,6 +500,9 @@ GR_RESULT grWsiWinQueuePresent(
         return GR_ERROR_OUT_OF_MEMORY; // TODO use better error code
     }
 
+    // Save new pipelines every now and then in case the application doesn't exit cleanly
+    pipelineCacheUpdate(grDevice);
+
     return GR_SUCCESS;
 }
 
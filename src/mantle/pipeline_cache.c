@@ -0,0 +1,267 @@
+#include <stdio.h>
+#include "pipeline_cache.h"
+#include "shader_compiler.h"
+
+#define PATH_LEN            (512)
+#define SAVE_INTERVAL_MS    (60 * 1000)
+
+// Header at the start of Vulkan pipeline cache data (version one)
+typedef struct {
+    uint32_t headerSize;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+} PipelineCacheHeader;
+
+static const char* getCachePath()
+{
+    const char* envValue = getenv("GRVK_PIPELINE_CACHE_PATH");
+
+    return envValue != NULL && strlen(envValue) > 0 ? envValue : NULL;
+}
+
+static void getCacheFileName(
+    char* fileName,
+    unsigned fileNameLen,
+    const char* cachePath,
+    const VkPhysicalDeviceProperties* props)
+{
+    char uuid[2 * VK_UUID_SIZE + 1];
+
+    // Cache data is only valid for the driver build that produced it
+    for (unsigned i = 0; i < VK_UUID_SIZE; i++) {
+        snprintf(&uuid[2 * i], 3, "%02x", props->pipelineCacheUUID[i]);
+    }
+
+    snprintf(fileName, fileNameLen, "%s/%s.vkpc", cachePath, uuid);
+}
+
+static bool isCompatibleData(
+    const VkPhysicalDeviceProperties* props,
+    const void* data,
+    size_t size)
+{
+    PipelineCacheHeader header;
+
+    if (size < sizeof(header)) {
+        return false;
+    }
+
+    memcpy(&header, data, sizeof(header));
+
+    return header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == props->vendorID &&
+           header.deviceID == props->deviceID &&
+           memcmp(header.pipelineCacheUUID, props->pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+static void* readCacheFile(
+    size_t* size,
+    const char* fileName,
+    const VkPhysicalDeviceProperties* props)
+{
+    void* data = NULL;
+
+    *size = 0;
+
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    long fileSize = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (fileSize > 0) {
+        data = malloc(fileSize);
+
+        if (fread(data, 1, fileSize, file) == (size_t)fileSize &&
+            isCompatibleData(props, data, fileSize)) {
+            *size = fileSize;
+        } else {
+            LOGW("ignoring stale or corrupted pipeline cache %s\n", fileName);
+            free(data);
+            data = NULL;
+        }
+    }
+
+    fclose(file);
+    return data;
+}
+
+VkPipelineCache pipelineCacheCreate(
+    const GrDevice* grDevice,
+    const void* data,
+    size_t size)
+{
+    VkPipelineCache vkPipelineCache = VK_NULL_HANDLE;
+
+    const VkPipelineCacheCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .initialDataSize = size,
+        .pInitialData = data,
+    };
+
+    VkResult res = VKD.vkCreatePipelineCache(grDevice->device, &createInfo, NULL,
+                                             &vkPipelineCache);
+    if (res != VK_SUCCESS) {
+        LOGE("vkCreatePipelineCache failed (%d)\n", res);
+        return VK_NULL_HANDLE;
+    }
+
+    return vkPipelineCache;
+}
+
+static size_t getVkPipelineCacheSize(
+    const GrDevice* grDevice,
+    VkPipelineCache vkPipelineCache)
+{
+    size_t size = 0;
+
+    VkResult res = VKD.vkGetPipelineCacheData(grDevice->device, vkPipelineCache, &size, NULL);
+    if (res != VK_SUCCESS) {
+        LOGE("vkGetPipelineCacheData failed (%d)\n", res);
+        return 0;
+    }
+
+    return size;
+}
+
+void pipelineCacheLoad(
+    GrDevice* grDevice)
+{
+    const char* cachePath = getCachePath();
+    char fileName[PATH_LEN];
+    void* data = NULL;
+    size_t size = 0;
+
+    // Pipelines are cached in memory even without a cache path
+    if (cachePath != NULL) {
+        VkPhysicalDeviceProperties props;
+        vki.vkGetPhysicalDeviceProperties(grDevice->physicalDevice, &props);
+
+        getCacheFileName(fileName, PATH_LEN, cachePath, &props);
+        data = readCacheFile(&size, fileName, &props);
+    }
+
+    grDevice->pipelineCache = pipelineCacheCreate(grDevice, data, size);
+    if (grDevice->pipelineCache == VK_NULL_HANDLE && data != NULL) {
+        LOGW("discarding pipeline cache %s\n", fileName);
+        grDevice->pipelineCache = pipelineCacheCreate(grDevice, NULL, 0);
+    }
+
+    if (grDevice->pipelineCache != VK_NULL_HANDLE) {
+        grDevice->pipelineCacheSavedSize = getVkPipelineCacheSize(grDevice,
+                                                                  grDevice->pipelineCache);
+    }
+    grDevice->pipelineCacheSaveTime = GetTickCount64();
+
+    if (data != NULL) {
+        LOGV("loaded %llu bytes from %s\n", (unsigned long long)size, fileName);
+    }
+
+    free(data);
+}
+
+void pipelineCacheSave(
+    GrDevice* grDevice)
+{
+    const char* cachePath = getCachePath();
+    char fileName[PATH_LEN];
+    char tempFileName[PATH_LEN];
+
+    if (cachePath == NULL || grDevice->pipelineCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    size_t size = getVkPipelineCacheSize(grDevice, grDevice->pipelineCache);
+    if (size == grDevice->pipelineCacheSavedSize) {
+        // No new pipelines
+        return;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vki.vkGetPhysicalDeviceProperties(grDevice->physicalDevice, &props);
+
+    CreateDirectoryA(cachePath, NULL);
+    getCacheFileName(fileName, PATH_LEN, cachePath, &props);
+    snprintf(tempFileName, PATH_LEN, "%s.%lu.tmp", fileName, GetCurrentProcessId());
+
+    // Keep the pipelines saved by other processes in the meantime. Merge into a temporary cache,
+    // the device cache may be used concurrently and can't be a merge destination.
+    size_t fileSize = 0;
+    void* fileData = readCacheFile(&fileSize, fileName, &props);
+    VkPipelineCache mergedCache = pipelineCacheCreate(grDevice, fileData, fileSize);
+    free(fileData);
+
+    if (mergedCache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    VkResult res = VKD.vkMergePipelineCaches(grDevice->device, mergedCache,
+                                             1, &grDevice->pipelineCache);
+    if (res != VK_SUCCESS) {
+        LOGE("vkMergePipelineCaches failed (%d)\n", res);
+        VKD.vkDestroyPipelineCache(grDevice->device, mergedCache, NULL);
+        return;
+    }
+
+    size_t mergedSize = getVkPipelineCacheSize(grDevice, mergedCache);
+    void* mergedData = malloc(mergedSize);
+
+    res = VKD.vkGetPipelineCacheData(grDevice->device, mergedCache, &mergedSize, mergedData);
+    VKD.vkDestroyPipelineCache(grDevice->device, mergedCache, NULL);
+
+    if (res != VK_SUCCESS) {
+        LOGE("vkGetPipelineCacheData failed (%d)\n", res);
+        free(mergedData);
+        return;
+    }
+
+    // Write to a temporary file first so that readers never see partial caches
+    FILE* file = fopen(tempFileName, "wb");
+    if (file == NULL) {
+        LOGW("failed to open %s for writing\n", tempFileName);
+        free(mergedData);
+        return;
+    }
+
+    bool written = fwrite(mergedData, 1, mergedSize, file) == mergedSize;
+    fclose(file);
+    free(mergedData);
+
+    if (!written || !MoveFileExA(tempFileName, fileName, MOVEFILE_REPLACE_EXISTING)) {
+        LOGW("failed to write %s\n", fileName);
+        remove(tempFileName);
+        return;
+    }
+
+    grDevice->pipelineCacheSavedSize = size;
+    LOGV("saved %llu bytes to %s\n", (unsigned long long)mergedSize, fileName);
+}
+
+void pipelineCacheUpdate(
+    GrDevice* grDevice)
+{
+    LONGLONG saveTime = grDevice->pipelineCacheSaveTime;
+    LONGLONG time = GetTickCount64();
+
+    if (time - saveTime < SAVE_INTERVAL_MS) {
+        return;
+    }
+
+    // Only let one thread save
+    if (InterlockedCompareExchange64(&grDevice->pipelineCacheSaveTime, time,
+                                     saveTime) != saveTime) {
+        return;
+    }
+
+    // Keep file I/O off the calling thread
+    if (!shaderCompilerSubmitPipelineCacheSave(grDevice->shaderCompiler)) {
+        pipelineCacheSave(grDevice);
+    }
+}
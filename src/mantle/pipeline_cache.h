@@ -0,0 +1,20 @@
+#ifndef PIPELINE_CACHE_H_
+#define PIPELINE_CACHE_H_
+
+#include "mantle_internal.h"
+
+VkPipelineCache pipelineCacheCreate(
+    const GrDevice* grDevice,
+    const void* data,
+    size_t size);
+
+void pipelineCacheLoad(
+    GrDevice* grDevice);
+
+void pipelineCacheSave(
+    GrDevice* grDevice);
+
+void pipelineCacheUpdate(
+    GrDevice* grDevice);
+
+#endif // PIPELINE_CACHE_H_
@@ -0,0 +1,510 @@
+#include "shader_compiler.h"
+#include "pipeline_cache.h"
+
+#define MAX_THREAD_COUNT    (16)
+#define BUCKET_COUNT        (256)
+
+typedef struct _ShaderCompileJob ShaderCompileJob;
+
+typedef enum _ShaderCompileJobType {
+    JOB_TYPE_SHADER,
+    JOB_TYPE_PIPELINE,
+    JOB_TYPE_PIPELINE_CACHE_SAVE,
+} ShaderCompileJobType;
+
+typedef struct _ShaderCompileJob {
+    ShaderCompileJobType type;
+    CompiledShader* compiledShader; // Null for non-shader jobs
+    GrPipeline* grPipeline;
+    PipelineSlot* pipelineSlot;
+    ShaderCompileJob* next;
+} ShaderCompileJob;
+
+typedef struct _ShaderCompiler {
+    GrDevice* grDevice;
+    CRITICAL_SECTION mutex;
+    CONDITION_VARIABLE jobCond; // Signaled when a job is queued or on shutdown
+    CONDITION_VARIABLE doneCond; // Signaled when a job is done
+    ShaderCompileJob* firstJob;
+    ShaderCompileJob* lastJob;
+    bool isShuttingDown;
+    unsigned threadCount;
+    HANDLE threads[MAX_THREAD_COUNT];
+    CompiledShader* buckets[BUCKET_COUNT]; // Compiled shaders, looked up by IL hash
+} ShaderCompiler;
+
+static unsigned getThreadCount()
+{
+    const char* envValue = getenv("GRVK_SHADER_COMPILER_THREADS");
+
+    if (envValue != NULL) {
+        return MIN(strtoul(envValue, NULL, 10), MAX_THREAD_COUNT);
+    }
+
+    // Leave one core to the application thread
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    return MAX(MIN(systemInfo.dwNumberOfProcessors - 1, MAX_THREAD_COUNT), 1);
+}
+
+static GR_RESULT createShaderModule(
+    GrDevice* grDevice,
+    CompiledShader* compiledShader,
+    IlcShader* ilcShader)
+{
+    VkShaderModule vkShaderModule = VK_NULL_HANDLE;
+
+    const VkShaderModuleCreateInfo createInfo = {
+        .sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .pNext = NULL,
+        .flags = 0,
+        .codeSize = ilcShader->codeSize,
+        .pCode = ilcShader->code,
+    };
+
+    VkResult res = VKD.vkCreateShaderModule(grDevice->device, &createInfo, NULL, &vkShaderModule);
+    if (res != VK_SUCCESS) {
+        LOGE("vkCreateShaderModule failed (%d)\n", res);
+        free(ilcShader->code);
+        free(ilcShader->bindings);
+        return getGrResult(res);
+    }
+
+    // Takes ownership of the SPIR-V code and bindings
+    compiledShader->shaderModule = vkShaderModule;
+    compiledShader->spirvSize = ilcShader->codeSize;
+    compiledShader->spirvCode = ilcShader->code;
+    compiledShader->bindingCount = ilcShader->bindingCount;
+    compiledShader->bindings = ilcShader->bindings;
+    return GR_SUCCESS;
+}
+
+static GR_RESULT compileShader(
+    GrDevice* grDevice,
+    CompiledShader* compiledShader)
+{
+    IlcShader ilcShader = ilcCompileShader(compiledShader->code, compiledShader->codeSize);
+
+    return createShaderModule(grDevice, compiledShader, &ilcShader);
+}
+
+static void destroyCompiledShader(
+    GrDevice* grDevice,
+    CompiledShader* compiledShader)
+{
+    VKD.vkDestroyShaderModule(grDevice->device, compiledShader->shaderModule, NULL);
+    free(compiledShader->spirvCode);
+    free(compiledShader->bindings);
+    free(compiledShader->code);
+    free(compiledShader);
+}
+
+static DWORD WINAPI workerThread(
+    LPVOID param)
+{
+    ShaderCompiler* shaderCompiler = (ShaderCompiler*)param;
+
+    EnterCriticalSection(&shaderCompiler->mutex);
+
+    for (;;) {
+        while (shaderCompiler->firstJob == NULL && !shaderCompiler->isShuttingDown) {
+            SleepConditionVariableCS(&shaderCompiler->jobCond, &shaderCompiler->mutex, INFINITE);
+        }
+
+        // Drain the queue before exiting
+        ShaderCompileJob* job = shaderCompiler->firstJob;
+        if (job == NULL) {
+            break;
+        }
+
+        shaderCompiler->firstJob = job->next;
+        if (shaderCompiler->firstJob == NULL) {
+            shaderCompiler->lastJob = NULL;
+        }
+
+        LeaveCriticalSection(&shaderCompiler->mutex);
+
+        if (job->type == JOB_TYPE_SHADER) {
+            GR_RESULT res = compileShader(shaderCompiler->grDevice, job->compiledShader);
+
+            EnterCriticalSection(&shaderCompiler->mutex);
+
+            job->compiledShader->compileResult = res;
+            job->compiledShader->isCompiled = true;
+            WakeAllConditionVariable(&shaderCompiler->doneCond);
+        } else if (job->type == JOB_TYPE_PIPELINE) {
+            // The pipeline wakes its own waiters
+            grPipelineCreateVkPipeline(job->grPipeline, job->pipelineSlot);
+
+            EnterCriticalSection(&shaderCompiler->mutex);
+        } else {
+            pipelineCacheSave(shaderCompiler->grDevice);
+
+            EnterCriticalSection(&shaderCompiler->mutex);
+        }
+
+        free(job);
+    }
+
+    LeaveCriticalSection(&shaderCompiler->mutex);
+    return 0;
+}
+
+ShaderCompiler* shaderCompilerCreate(
+    GrDevice* grDevice)
+{
+    ShaderCompiler* shaderCompiler = malloc(sizeof(ShaderCompiler));
+    *shaderCompiler = (ShaderCompiler) {
+        .grDevice = grDevice,
+        .mutex = { 0 }, // Initialized below
+        .jobCond = CONDITION_VARIABLE_INIT,
+        .doneCond = CONDITION_VARIABLE_INIT,
+        .firstJob = NULL,
+        .lastJob = NULL,
+        .isShuttingDown = false,
+        .threadCount = 0,
+        .threads = { NULL }, // Initialized below
+        .buckets = { NULL },
+    };
+
+    InitializeCriticalSectionAndSpinCount(&shaderCompiler->mutex, 0);
+
+    unsigned threadCount = getThreadCount();
+    for (unsigned i = 0; i < threadCount; i++) {
+        HANDLE thread = CreateThread(NULL, 0, workerThread, shaderCompiler, 0, NULL);
+
+        if (thread == NULL) {
+            LOGW("failed to create shader compiler thread (%lu)\n", GetLastError());
+            break;
+        }
+
+        shaderCompiler->threads[shaderCompiler->threadCount] = thread;
+        shaderCompiler->threadCount++;
+    }
+
+    LOGV("using %u shader compiler threads\n", shaderCompiler->threadCount);
+    return shaderCompiler;
+}
+
+void shaderCompilerDestroy(
+    ShaderCompiler* shaderCompiler)
+{
+    EnterCriticalSection(&shaderCompiler->mutex);
+    shaderCompiler->isShuttingDown = true;
+    WakeAllConditionVariable(&shaderCompiler->jobCond);
+    LeaveCriticalSection(&shaderCompiler->mutex);
+
+    for (unsigned i = 0; i < shaderCompiler->threadCount; i++) {
+        WaitForSingleObject(shaderCompiler->threads[i], INFINITE);
+        CloseHandle(shaderCompiler->threads[i]);
+    }
+
+    // Release shaders still referenced by shader and pipeline objects
+    for (unsigned i = 0; i < BUCKET_COUNT; i++) {
+        CompiledShader* compiledShader = shaderCompiler->buckets[i];
+
+        while (compiledShader != NULL) {
+            CompiledShader* next = compiledShader->next;
+
+            destroyCompiledShader(shaderCompiler->grDevice, compiledShader);
+            compiledShader = next;
+        }
+    }
+
+    DeleteCriticalSection(&shaderCompiler->mutex);
+    free(shaderCompiler);
+}
+
+static CompiledShader* findCompiledShader(
+    ShaderCompiler* shaderCompiler,
+    uint64_t hash,
+    const void* code,
+    unsigned codeSize)
+{
+    for (CompiledShader* compiledShader = shaderCompiler->buckets[hash % BUCKET_COUNT];
+         compiledShader != NULL; compiledShader = compiledShader->next) {
+        if (compiledShader->hash == hash && compiledShader->codeSize == codeSize &&
+            memcmp(compiledShader->code, code, codeSize) == 0) {
+            return compiledShader;
+        }
+    }
+
+    return NULL;
+}
+
+static CompiledShader* addCompiledShader(
+    ShaderCompiler* shaderCompiler,
+    uint64_t hash,
+    const void* code,
+    unsigned codeSize)
+{
+    CompiledShader** bucket = &shaderCompiler->buckets[hash % BUCKET_COUNT];
+
+    // The application is free to release the IL code once the call returns
+    CompiledShader* compiledShader = malloc(sizeof(CompiledShader));
+    *compiledShader = (CompiledShader) {
+        .hash = hash,
+        .codeSize = codeSize,
+        .code = malloc(codeSize),
+        .shaderModule = VK_NULL_HANDLE,
+        .spirvSize = 0,
+        .spirvCode = NULL,
+        .bindingCount = 0,
+        .bindings = NULL,
+        .isCompiled = false,
+        .compileResult = GR_SUCCESS,
+        .refCount = 1,
+        .next = *bucket,
+    };
+
+    memcpy(compiledShader->code, code, codeSize);
+    *bucket = compiledShader;
+
+    return compiledShader;
+}
+
+static void queueJob(
+    ShaderCompiler* shaderCompiler,
+    ShaderCompileJobType type,
+    CompiledShader* compiledShader,
+    GrPipeline* grPipeline,
+    PipelineSlot* pipelineSlot)
+{
+    ShaderCompileJob* job = malloc(sizeof(ShaderCompileJob));
+    *job = (ShaderCompileJob) {
+        .type = type,
+        .compiledShader = compiledShader,
+        .grPipeline = grPipeline,
+        .pipelineSlot = pipelineSlot,
+        .next = NULL,
+    };
+
+    if (shaderCompiler->lastJob != NULL) {
+        shaderCompiler->lastJob->next = job;
+    } else {
+        shaderCompiler->firstJob = job;
+    }
+    shaderCompiler->lastJob = job;
+
+    WakeConditionVariable(&shaderCompiler->jobCond);
+}
+
+CompiledShader* shaderCompilerSubmit(
+    ShaderCompiler* shaderCompiler,
+    const void* code,
+    unsigned codeSize)
+{
+    uint64_t hash = getHash(code, codeSize);
+
+    EnterCriticalSection(&shaderCompiler->mutex);
+
+    // Share the compilation of identical shaders
+    CompiledShader* compiledShader = findCompiledShader(shaderCompiler, hash, code, codeSize);
+    if (compiledShader != NULL) {
+        compiledShader->refCount++;
+        LeaveCriticalSection(&shaderCompiler->mutex);
+
+        LOGV("reusing compiled shader %016llx\n", hash);
+        return compiledShader;
+    }
+
+    compiledShader = addCompiledShader(shaderCompiler, hash, code, codeSize);
+
+    if (shaderCompiler->threadCount == 0) {
+        // Compile synchronously, concurrent lookups wait for completion
+        LeaveCriticalSection(&shaderCompiler->mutex);
+
+        GR_RESULT res = compileShader(shaderCompiler->grDevice, compiledShader);
+
+        EnterCriticalSection(&shaderCompiler->mutex);
+        compiledShader->compileResult = res;
+        compiledShader->isCompiled = true;
+        WakeAllConditionVariable(&shaderCompiler->doneCond);
+        LeaveCriticalSection(&shaderCompiler->mutex);
+        return compiledShader;
+    }
+
+    queueJob(shaderCompiler, JOB_TYPE_SHADER, compiledShader, NULL, NULL);
+
+    LeaveCriticalSection(&shaderCompiler->mutex);
+    return compiledShader;
+}
+
+CompiledShader* shaderCompilerLoad(
+    ShaderCompiler* shaderCompiler,
+    const void* code,
+    unsigned codeSize,
+    const void* spirvCode,
+    unsigned spirvSize,
+    const void* bindings,
+    unsigned bindingCount)
+{
+    uint64_t hash = getHash(code, codeSize);
+
+    EnterCriticalSection(&shaderCompiler->mutex);
+
+    CompiledShader* compiledShader = findCompiledShader(shaderCompiler, hash, code, codeSize);
+    if (compiledShader != NULL) {
+        compiledShader->refCount++;
+        LeaveCriticalSection(&shaderCompiler->mutex);
+
+        LOGV("reusing compiled shader %016llx\n", hash);
+        return compiledShader;
+    }
+
+    compiledShader = addCompiledShader(shaderCompiler, hash, code, codeSize);
+
+    // Skip compilation, concurrent lookups wait for the module creation
+    LeaveCriticalSection(&shaderCompiler->mutex);
+
+    IlcShader ilcShader = {
+        .codeSize = spirvSize,
+        .code = malloc(spirvSize),
+        .bindingCount = bindingCount,
+        .bindings = malloc(bindingCount * sizeof(IlcBinding)),
+    };
+
+    memcpy(ilcShader.code, spirvCode, spirvSize);
+    memcpy(ilcShader.bindings, bindings, bindingCount * sizeof(IlcBinding));
+
+    GR_RESULT res = createShaderModule(shaderCompiler->grDevice, compiledShader, &ilcShader);
+
+    EnterCriticalSection(&shaderCompiler->mutex);
+    compiledShader->compileResult = res;
+    compiledShader->isCompiled = true;
+    WakeAllConditionVariable(&shaderCompiler->doneCond);
+    LeaveCriticalSection(&shaderCompiler->mutex);
+    return compiledShader;
+}
+
+bool shaderCompilerSubmitPipeline(
+    ShaderCompiler* shaderCompiler,
+    GrPipeline* grPipeline,
+    PipelineSlot* pipelineSlot)
+{
+    if (shaderCompiler->threadCount == 0) {
+        return false;
+    }
+
+    EnterCriticalSection(&shaderCompiler->mutex);
+    queueJob(shaderCompiler, JOB_TYPE_PIPELINE, NULL, grPipeline, pipelineSlot);
+    LeaveCriticalSection(&shaderCompiler->mutex);
+    return true;
+}
+
+bool shaderCompilerSubmitPipelineCacheSave(
+    ShaderCompiler* shaderCompiler)
+{
+    if (shaderCompiler->threadCount == 0) {
+        return false;
+    }
+
+    EnterCriticalSection(&shaderCompiler->mutex);
+    queueJob(shaderCompiler, JOB_TYPE_PIPELINE_CACHE_SAVE, NULL, NULL, NULL);
+    LeaveCriticalSection(&shaderCompiler->mutex);
+    return true;
+}
+
+static ShaderCompileJob* removeQueuedJob(
+    ShaderCompiler* shaderCompiler,
+    const CompiledShader* compiledShader)
+{
+    // Returns the shader job if no worker picked it up yet
+    ShaderCompileJob* prevJob = NULL;
+    for (ShaderCompileJob* job = shaderCompiler->firstJob; job != NULL; job = job->next) {
+        if (job->compiledShader != compiledShader) {
+            prevJob = job;
+            continue;
+        }
+
+        if (prevJob != NULL) {
+            prevJob->next = job->next;
+        } else {
+            shaderCompiler->firstJob = job->next;
+        }
+        if (shaderCompiler->lastJob == job) {
+            shaderCompiler->lastJob = prevJob;
+        }
+
+        return job;
+    }
+
+    return NULL;
+}
+
+GR_RESULT shaderCompilerWait(
+    ShaderCompiler* shaderCompiler,
+    CompiledShader* compiledShader)
+{
+    EnterCriticalSection(&shaderCompiler->mutex);
+
+    // Compile on the calling thread if no worker picked the shader up yet
+    ShaderCompileJob* job = removeQueuedJob(shaderCompiler, compiledShader);
+    if (job != NULL) {
+        LeaveCriticalSection(&shaderCompiler->mutex);
+
+        GR_RESULT res = compileShader(shaderCompiler->grDevice, compiledShader);
+
+        EnterCriticalSection(&shaderCompiler->mutex);
+        compiledShader->compileResult = res;
+        compiledShader->isCompiled = true;
+        WakeAllConditionVariable(&shaderCompiler->doneCond);
+
+        free(job);
+    }
+
+    while (!compiledShader->isCompiled) {
+        SleepConditionVariableCS(&shaderCompiler->doneCond, &shaderCompiler->mutex, INFINITE);
+    }
+
+    GR_RESULT res = compiledShader->compileResult;
+
+    LeaveCriticalSection(&shaderCompiler->mutex);
+    return res;
+}
+
+void shaderCompilerRetain(
+    ShaderCompiler* shaderCompiler,
+    CompiledShader* compiledShader)
+{
+    EnterCriticalSection(&shaderCompiler->mutex);
+    compiledShader->refCount++;
+    LeaveCriticalSection(&shaderCompiler->mutex);
+}
+
+void shaderCompilerRelease(
+    ShaderCompiler* shaderCompiler,
+    CompiledShader* compiledShader)
+{
+    EnterCriticalSection(&shaderCompiler->mutex);
+
+    assert(compiledShader->refCount > 0);
+    compiledShader->refCount--;
+    if (compiledShader->refCount > 0) {
+        LeaveCriticalSection(&shaderCompiler->mutex);
+        return;
+    }
+
+    // Unregister so that no new reference can be taken
+    CompiledShader** link = &shaderCompiler->buckets[compiledShader->hash % BUCKET_COUNT];
+    while (*link != compiledShader) {
+        link = &(*link)->next;
+    }
+    *link = compiledShader->next;
+
+    // Drop a queued compilation, a running one still refers to the shader
+    ShaderCompileJob* job = removeQueuedJob(shaderCompiler, compiledShader);
+    if (job != NULL) {
+        free(job);
+    } else {
+        while (!compiledShader->isCompiled) {
+            SleepConditionVariableCS(&shaderCompiler->doneCond, &shaderCompiler->mutex,
+                                     INFINITE);
+        }
+    }
+
+    LeaveCriticalSection(&shaderCompiler->mutex);
+
+    destroyCompiledShader(shaderCompiler->grDevice, compiledShader);
+}
@@ -0,0 +1,46 @@
+#ifndef SHADER_COMPILER_H_
+#define SHADER_COMPILER_H_
+
+#include "mantle_internal.h"
+
+ShaderCompiler* shaderCompilerCreate(
+    GrDevice* grDevice);
+
+void shaderCompilerDestroy(
+    ShaderCompiler* shaderCompiler);
+
+CompiledShader* shaderCompilerSubmit(
+    ShaderCompiler* shaderCompiler,
+    const void* code,
+    unsigned codeSize);
+
+CompiledShader* shaderCompilerLoad(
+    ShaderCompiler* shaderCompiler,
+    const void* code,
+    unsigned codeSize,
+    const void* spirvCode,
+    unsigned spirvSize,
+    const void* bindings,
+    unsigned bindingCount);
+
+bool shaderCompilerSubmitPipeline(
+    ShaderCompiler* shaderCompiler,
+    GrPipeline* grPipeline,
+    PipelineSlot* pipelineSlot);
+
+bool shaderCompilerSubmitPipelineCacheSave(
+    ShaderCompiler* shaderCompiler);
+
+GR_RESULT shaderCompilerWait(
+    ShaderCompiler* shaderCompiler,
+    CompiledShader* compiledShader);
+
+void shaderCompilerRetain(
+    ShaderCompiler* shaderCompiler,
+    CompiledShader* compiledShader);
+
+void shaderCompilerRelease(
+    ShaderCompiler* shaderCompiler,
+    CompiledShader* compiledShader);
+
+#endif // SHADER_COMPILER_H_
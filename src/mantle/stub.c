@@ -48,27 +48,6 @@ GR_RESULT grPinSystemMemory(
     return GR_UNSUPPORTED;
 }
 
-// Shader and Pipeline Functions
-
-GR_RESULT grStorePipeline(
-    GR_PIPELINE pipeline,
-    GR_SIZE* pDataSize,
-    GR_VOID* pData)
-{
-    LOGW("STUB\n");
-    return GR_UNSUPPORTED;
-}
-
-GR_RESULT grLoadPipeline(
-    GR_DEVICE device,
-    GR_SIZE dataSize,
-    const GR_VOID* pData,
-    GR_PIPELINE* pPipeline)
-{
-    LOGW("STUB\n");
-    return GR_UNSUPPORTED;
-}
-
 // Query and Synchronization Functions
 
 GR_RESULT grCreateQueryPool(
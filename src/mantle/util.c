@@ -4,6 +4,9 @@
 #define PACK_FORMAT(channel, numeric) \
     ((channel) << 16 | (numeric))
 
+#define FNV_OFFSET_BASIS    (0xCBF29CE484222325ull)
+#define FNV_PRIME           (0x00000100000001B3ull)
+
 GR_PHYSICAL_GPU_TYPE getGrPhysicalGpuType(
     VkPhysicalDeviceType type)
 {
@@ -974,3 +977,18 @@ VkImageSubresourceRange getVkImageSubresourceRange(
                       VK_REMAINING_ARRAY_LAYERS : subresourceRange.arraySize * layerFactor,
     };
 }
+
+uint64_t getHash(
+    const void* data,
+    unsigned size)
+{
+    // FNV-1a
+    const uint8_t* bytes = data;
+    uint64_t hash = FNV_OFFSET_BASIS;
+
+    for (unsigned i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * FNV_PRIME;
+    }
+
+    return hash;
+}
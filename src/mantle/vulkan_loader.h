@@ -10,6 +10,82 @@
 #define VULKAN_FN(name) \
     PFN_##name name
 
+// VK_EXT_extended_dynamic_state3 is newer than the bundled Vulkan headers
+#ifndef VK_EXT_extended_dynamic_state3
+#define VK_EXT_extended_dynamic_state3 1
+#define VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME "VK_EXT_extended_dynamic_state3"
+
+#define VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT \
+    ((VkStructureType)1000455000)
+#define VK_DYNAMIC_STATE_POLYGON_MODE_EXT \
+    ((VkDynamicState)1000455004)
+#define VK_DYNAMIC_STATE_COLOR_BLEND_ENABLE_EXT \
+    ((VkDynamicState)1000455010)
+#define VK_DYNAMIC_STATE_COLOR_BLEND_EQUATION_EXT \
+    ((VkDynamicState)1000455011)
+
+typedef struct VkPhysicalDeviceExtendedDynamicState3FeaturesEXT {
+    VkStructureType sType;
+    void* pNext;
+    VkBool32 extendedDynamicState3TessellationDomainOrigin;
+    VkBool32 extendedDynamicState3DepthClampEnable;
+    VkBool32 extendedDynamicState3PolygonMode;
+    VkBool32 extendedDynamicState3RasterizationSamples;
+    VkBool32 extendedDynamicState3SampleMask;
+    VkBool32 extendedDynamicState3AlphaToCoverageEnable;
+    VkBool32 extendedDynamicState3AlphaToOneEnable;
+    VkBool32 extendedDynamicState3LogicOpEnable;
+    VkBool32 extendedDynamicState3ColorBlendEnable;
+    VkBool32 extendedDynamicState3ColorBlendEquation;
+    VkBool32 extendedDynamicState3ColorWriteMask;
+    VkBool32 extendedDynamicState3RasterizationStream;
+    VkBool32 extendedDynamicState3ConservativeRasterizationMode;
+    VkBool32 extendedDynamicState3ExtraPrimitiveOverestimationSize;
+    VkBool32 extendedDynamicState3DepthClipEnable;
+    VkBool32 extendedDynamicState3SampleLocationsEnable;
+    VkBool32 extendedDynamicState3ColorBlendAdvanced;
+    VkBool32 extendedDynamicState3ProvokingVertexMode;
+    VkBool32 extendedDynamicState3LineRasterizationMode;
+    VkBool32 extendedDynamicState3LineStippleEnable;
+    VkBool32 extendedDynamicState3DepthClipNegativeOneToOne;
+    VkBool32 extendedDynamicState3ViewportWScalingEnable;
+    VkBool32 extendedDynamicState3ViewportSwizzle;
+    VkBool32 extendedDynamicState3CoverageToColorEnable;
+    VkBool32 extendedDynamicState3CoverageToColorLocation;
+    VkBool32 extendedDynamicState3CoverageModulationMode;
+    VkBool32 extendedDynamicState3CoverageModulationTableEnable;
+    VkBool32 extendedDynamicState3CoverageModulationTable;
+    VkBool32 extendedDynamicState3CoverageReductionMode;
+    VkBool32 extendedDynamicState3RepresentativeFragmentTestEnable;
+    VkBool32 extendedDynamicState3ShadingRateImageEnable;
+} VkPhysicalDeviceExtendedDynamicState3FeaturesEXT;
+
+typedef struct VkColorBlendEquationEXT {
+    VkBlendFactor srcColorBlendFactor;
+    VkBlendFactor dstColorBlendFactor;
+    VkBlendOp colorBlendOp;
+    VkBlendFactor srcAlphaBlendFactor;
+    VkBlendFactor dstAlphaBlendFactor;
+    VkBlendOp alphaBlendOp;
+} VkColorBlendEquationEXT;
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetColorBlendEnableEXT)(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstAttachment,
+    uint32_t attachmentCount,
+    const VkBool32* pColorBlendEnables);
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetColorBlendEquationEXT)(
+    VkCommandBuffer commandBuffer,
+    uint32_t firstAttachment,
+    uint32_t attachmentCount,
+    const VkColorBlendEquationEXT* pColorBlendEquations);
+
+typedef void (VKAPI_PTR *PFN_vkCmdSetPolygonModeEXT)(
+    VkCommandBuffer commandBuffer,
+    VkPolygonMode polygonMode);
+#endif
+
 typedef struct _VULKAN_LIBRARY {
     VULKAN_FN(vkCreateInstance);
     VULKAN_FN(vkEnumerateInstanceExtensionProperties);
@@ -207,6 +283,12 @@ typedef struct _VULKAN_DEVICE {
     VULKAN_FN(vkCmdSetStencilTestEnableEXT);
     VULKAN_FN(vkCmdSetViewportWithCountEXT);
 #endif
+
+#ifdef VK_EXT_extended_dynamic_state3
+    VULKAN_FN(vkCmdSetColorBlendEnableEXT);
+    VULKAN_FN(vkCmdSetColorBlendEquationEXT);
+    VULKAN_FN(vkCmdSetPolygonModeEXT);
+#endif
 } VULKAN_DEVICE;
 
 extern VULKAN_LIBRARY vkl;
@@ -0,0 +1,110 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "amdilc_internal.h"
+
+#ifndef ILC_COUNT_ALLOCS
+#error "amdil-bench must be built with ILC_COUNT_ALLOCS"
+#endif
+
+static uint8_t* readFile(
+    unsigned* size,
+    const char* fileName)
+{
+    FILE* file = fopen(fileName, "rb");
+    assert(file != NULL);
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    uint8_t* buf = malloc(*size);
+    fseek(file, 0, SEEK_SET);
+    fread(buf, 1, *size, file);
+    fclose(file);
+
+    return buf;
+}
+
+static double getElapsedNs(
+    LARGE_INTEGER start,
+    LARGE_INTEGER end)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    return (double)(end.QuadPart - start.QuadPart) * 1e9 / frequency.QuadPart;
+}
+
+static void benchShader(
+    const char* fileName,
+    unsigned iterationCount)
+{
+    unsigned size;
+    uint8_t* code = readFile(&size, fileName);
+    double decodeNs = 0.0;
+    double compileNs = 0.0;
+    unsigned long allocCount = 0;
+    unsigned instrCount = 0;
+    unsigned wordCount = 0;
+
+    for (unsigned i = 0; i < iterationCount; i++) {
+        LARGE_INTEGER start, decoded, compiled;
+
+        gIlcAllocCount = 0;
+
+        QueryPerformanceCounter(&start);
+        Kernel* kernel = ilcDecodeStream((Token*)code, size / sizeof(Token));
+        QueryPerformanceCounter(&decoded);
+        ilcOptimizeKernel(kernel, "bench");
+        IlcShader shader = ilcCompileKernel(kernel, "bench");
+        QueryPerformanceCounter(&compiled);
+
+        decodeNs += getElapsedNs(start, decoded);
+        compileNs += getElapsedNs(decoded, compiled);
+        allocCount = gIlcAllocCount;
+        instrCount = kernel->instrCount;
+        wordCount = shader.codeSize / sizeof(uint32_t);
+
+        free(shader.code);
+        free(shader.bindings);
+        free(kernel);
+    }
+
+    // Strip directories and extension
+    const char* name = fileName;
+    for (const char* c = fileName; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') {
+            name = c + 1;
+        }
+    }
+    int nameLen = strchr(name, '.') != NULL ? strchr(name, '.') - name : strlen(name);
+
+    printf("%.*s %u %.1f %.1f %lu %u\n", nameLen, name, instrCount,
+           decodeNs / iterationCount / instrCount, compileNs / iterationCount / instrCount,
+           allocCount, wordCount);
+
+    free(code);
+}
+
+int main(int argc, char *args[])
+{
+    if (argc < 3) {
+        printf("usage: %s iterations il.bin...\n"
+               "  Prints, for each shader: name, instruction count, decode and compile ns per\n"
+               "  instruction, allocations per compilation and SPIR-V word count.\n", args[0]);
+        return 1;
+    }
+
+    unsigned iterationCount = strtoul(args[1], NULL, 10);
+    assert(iterationCount > 0);
+
+    // Keep the output parseable and logging out of the measurements
+    gLogLevel = LOG_LEVEL_NONE;
+
+    for (int i = 2; i < argc; i++) {
+        benchShader(args[i], iterationCount);
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+#!/usr/bin/python
+
+import glob
+import os
+import subprocess
+import sys
+
+# Compares compiler timings, allocation counts and SPIR-V sizes against res/bench_baseline.txt.
+# Timings are machine specific: after a deliberate performance change, or when benchmarking on
+# a new machine, regenerate the baseline with `amdil-bench.py --update-baseline` and commit it.
+
+# Relative slowdown tolerated before a timing counts as a regression
+TIME_TOLERANCE = 1.25
+ITERATION_COUNT = 20
+# Best timing over several runs is kept to filter out scheduling noise
+RUN_COUNT = 5
+
+dirPath = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'res')
+baselinePath = os.path.join(dirPath, 'bench_baseline.txt')
+binPaths = sorted(glob.glob(os.path.join(dirPath, 'il_*.bin')))
+update = '--update-baseline' in sys.argv
+
+# name instrs decode_ns/instr compile_ns/instr allocs words
+results = {}
+for _ in range(RUN_COUNT):
+    output = subprocess.run(['wine', 'test/amdil-bench.exe', str(ITERATION_COUNT)] + binPaths,
+                            stdout=subprocess.PIPE, check=True).stdout.decode()
+
+    for line in output.splitlines():
+        fields = line.split()
+        best = results.get(fields[0])
+        if best is not None:
+            fields[2] = min(fields[2], best[1], key=float)
+            fields[3] = min(fields[3], best[2], key=float)
+        results[fields[0]] = fields[1:]
+
+for name, fields in sorted(results.items()):
+    print('{}: {} instrs, {} ns/instr decode, {} ns/instr compile, {} allocs, {} words'
+          .format(name, *fields))
+
+if update:
+    with open(baselinePath, 'w') as f:
+        f.write('# name decode_ns/instr compile_ns/instr allocs words\n')
+        f.write('# Timings are machine specific, regenerate with amdil-bench.py --update-baseline\n')
+        for name, fields in sorted(results.items()):
+            f.write('{} {} {} {} {}\n'.format(name, *fields[1:]))
+    exit(0)
+
+failed = False
+with open(baselinePath, 'r') as f:
+    for line in f:
+        if line.startswith('#'):
+            continue
+
+        name, decodeNs, compileNs, allocs, words = line.split()
+        if name not in results:
+            print('{}: missing result'.format(name))
+            failed = True
+            continue
+
+        _, curDecodeNs, curCompileNs, curAllocs, curWords = results[name]
+        checks = [
+            ('decode ns/instr', float(curDecodeNs), float(decodeNs) * TIME_TOLERANCE),
+            ('compile ns/instr', float(curCompileNs), float(compileNs) * TIME_TOLERANCE),
+            ('allocs', int(curAllocs), int(allocs)),
+            ('words', int(curWords), int(words)),
+        ]
+
+        for label, value, limit in checks:
+            if value > limit:
+                print('{}: {} regressed, got {}, expected at most {}'.format(name, label, value, limit))
+                failed = True
+
+if failed:
+    exit(1)
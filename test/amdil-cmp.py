@@ -5,13 +5,35 @@ import os
 import subprocess
 import sys
 
+# usage: amdil-cmp.py name [option removed_count]
+# With an option, the optimizer pass enabled by that environment variable runs first, the output
+# is compared to il_<name>_opt.txt and must have removed_count instructions less than il_<name>.txt
+
 name = sys.argv[1]
+option = sys.argv[2] if len(sys.argv) > 3 else None
 dirPath = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'res')
 binPath = os.path.join(dirPath, 'il_{}.bin'.format(name))
 outPath = 'il_{}_out.txt'.format(name)
 refPath = os.path.join(dirPath, 'il_{}.txt'.format(name))
 
-subprocess.run(['wine', 'test/amdil-dis.exe', binPath, outPath])
+if option is None:
+    subprocess.run(['wine', 'test/amdil-dis.exe', binPath, outPath])
+else:
+    env = dict(os.environ)
+    env[option] = '1'
+    subprocess.run(['wine', 'test/amdil-dis.exe', '-O', binPath, outPath], env=env)
+
+    with open(outPath, 'r') as f:
+        outLineCount = len(f.readlines())
+    with open(refPath, 'r') as f:
+        refLineCount = len(f.readlines())
+
+    removedCount = refLineCount - outLineCount
+    if removedCount != int(sys.argv[3]):
+        print("removed {} instructions, expected {}".format(removedCount, sys.argv[3]))
+        exit(1)
+
+    refPath = os.path.join(dirPath, 'il_{}_opt.txt'.format(name))
 
 with open(outPath, 'rb') as f:
     bytes = f.read()
@@ -1,16 +1,21 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include "amdilc.h"
+#include <string.h>
+#include "amdilc_internal.h"
 
 int main(int argc, char *args[])
 {
-    if (argc < 3) {
-        printf("usage: %s il.bin il.txt\n", args[0]);
+    // -O runs the optimizer passes enabled through GRVK_SHADER_* before disassembling
+    bool optimize = argc > 1 && strcmp(args[1], "-O") == 0;
+    int argIdx = optimize ? 2 : 1;
+
+    if (argc < argIdx + 2) {
+        printf("usage: %s [-O] il.bin il.txt\n", args[0]);
         return 1;
     }
 
-    FILE* inFile = fopen(args[1], "rb");
+    FILE* inFile = fopen(args[argIdx], "rb");
     assert(inFile != NULL);
 
     unsigned inSize;
@@ -22,8 +27,16 @@ int main(int argc, char *args[])
     fread(inBuf, 1, inSize, inFile);
     fclose(inFile);
 
-    FILE* outFile = fopen(args[2], "wb");
-    ilcDisassembleShader(outFile, inBuf, inSize);
+    FILE* outFile = fopen(args[argIdx + 1], "wb");
+    if (optimize) {
+        Kernel* kernel = ilcDecodeStream((Token*)inBuf, inSize / sizeof(Token));
+        ilcOptimizeKernel(kernel, args[argIdx]);
+        ilcDumpKernel(outFile, kernel);
+        // The decoder allocates the kernel and its IR as a single block
+        free(kernel);
+    } else {
+        ilcDisassembleShader(outFile, inBuf, inSize);
+    }
     fclose(outFile);
 
     return 0;
@@ -0,0 +1,266 @@
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+#include "amdilc_internal.h"
+
+#define PATH_LEN    (512)
+#define MAX_THREADS (64)
+
+typedef struct {
+    const char* inDir;
+    const char* outDir;
+    bool cache;
+    unsigned fileCount;
+    char** fileNames;
+    volatile LONG nextFile;
+    volatile LONG failCount;
+    volatile LONG wordCount;
+} Context;
+
+static uint8_t* readFile(
+    unsigned* size,
+    const char* fileName)
+{
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    fseek(file, 0, SEEK_END);
+    *size = ftell(file);
+    uint8_t* buf = malloc(*size);
+    fseek(file, 0, SEEK_SET);
+    fread(buf, 1, *size, file);
+    fclose(file);
+
+    return buf;
+}
+
+static void compileFile(
+    Context* ctx,
+    const char* fileName)
+{
+    char inPath[PATH_LEN];
+    char outPath[PATH_LEN];
+    unsigned inSize;
+
+    snprintf(inPath, PATH_LEN, "%s/%s", ctx->inDir, fileName);
+    uint8_t* inBuf = readFile(&inSize, inPath);
+    if (inBuf == NULL) {
+        printf("failed to read %s\n", inPath);
+        InterlockedIncrement(&ctx->failCount);
+        return;
+    }
+
+    // Cache entries are written by the compiler itself
+    IlcShader shader = ilcCompileShader(inBuf, inSize);
+    InterlockedExchangeAdd(&ctx->wordCount, shader.codeSize / sizeof(uint32_t));
+
+    if (!ctx->cache) {
+        snprintf(outPath, PATH_LEN, "%s/%.*s.spv", ctx->outDir,
+                 (int)(strrchr(fileName, '.') - fileName), fileName);
+
+        FILE* outFile = fopen(outPath, "wb");
+        if (outFile == NULL) {
+            printf("failed to write %s\n", outPath);
+            InterlockedIncrement(&ctx->failCount);
+        } else {
+            fwrite(shader.code, 1, shader.codeSize, outFile);
+            fclose(outFile);
+        }
+    }
+
+    free(shader.code);
+    free(shader.bindings);
+    free(inBuf);
+}
+
+static DWORD WINAPI workerThread(
+    LPVOID param)
+{
+    Context* ctx = (Context*)param;
+
+    for (;;) {
+        LONG i = InterlockedIncrement(&ctx->nextFile) - 1;
+
+        if (i >= ctx->fileCount) {
+            break;
+        }
+
+        compileFile(ctx, ctx->fileNames[i]);
+    }
+
+    return 0;
+}
+
+static bool isIlFile(
+    const char* fileName)
+{
+    Token header[2];
+
+    FILE* file = fopen(fileName, "rb");
+    if (file == NULL) {
+        return false;
+    }
+
+    bool isRead = fread(header, sizeof(Token), 2, file) == 2;
+    fclose(file);
+
+    // Language and version tokens, rejects the SPIR-V written next to the IL by shader dumps
+    return isRead &&
+           GET_BITS(header[0], 8, 31) == 0 &&
+           GET_BITS(header[0], 0, 7) < IL_LANG_LAST &&
+           GET_BITS(header[1], 16, 23) < IL_SHADER_LAST &&
+           GET_BITS(header[1], 26, 31) == 0;
+}
+
+static void listFiles(
+    Context* ctx)
+{
+    char path[PATH_LEN];
+    char pattern[PATH_LEN];
+    WIN32_FIND_DATAA findData;
+
+    snprintf(pattern, PATH_LEN, "%s/*.bin", ctx->inDir);
+
+    HANDLE find = FindFirstFileA(pattern, &findData);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+
+    do {
+        if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0) {
+            continue;
+        }
+
+        snprintf(path, PATH_LEN, "%s/%s", ctx->inDir, findData.cFileName);
+        if (!isIlFile(path)) {
+            printf("skipping %s, not an IL shader\n", path);
+            continue;
+        }
+
+        ctx->fileCount++;
+        ctx->fileNames = realloc(ctx->fileNames, ctx->fileCount * sizeof(char*));
+        ctx->fileNames[ctx->fileCount - 1] = strdup(findData.cFileName);
+    } while (FindNextFileA(find, &findData));
+
+    FindClose(find);
+}
+
+static unsigned countInstructions(
+    Context* ctx)
+{
+    char inPath[PATH_LEN];
+    unsigned instrCount = 0;
+
+    for (unsigned i = 0; i < ctx->fileCount; i++) {
+        unsigned inSize;
+
+        snprintf(inPath, PATH_LEN, "%s/%s", ctx->inDir, ctx->fileNames[i]);
+        uint8_t* inBuf = readFile(&inSize, inPath);
+        if (inBuf == NULL) {
+            continue;
+        }
+
+        // The decoder allocates the kernel and its IR as a single block
+        Kernel* kernel = ilcDecodeStream((Token*)inBuf, inSize / sizeof(Token));
+        instrCount += kernel->instrCount;
+        free(kernel);
+        free(inBuf);
+    }
+
+    return instrCount;
+}
+
+int main(int argc, char *args[])
+{
+    Context ctx = {
+        .inDir = NULL,
+        .outDir = NULL,
+        .cache = false,
+        .fileCount = 0,
+        .fileNames = NULL,
+        .nextFile = 0,
+        .failCount = 0,
+        .wordCount = 0,
+    };
+    unsigned threadCount = 0;
+    int argIdx = 1;
+
+    for (; argIdx < argc && args[argIdx][0] == '-'; argIdx++) {
+        if (strcmp(args[argIdx], "-cache") == 0) {
+            ctx.cache = true;
+        } else if (strcmp(args[argIdx], "-j") == 0 && argIdx + 1 < argc) {
+            threadCount = strtoul(args[++argIdx], NULL, 10);
+        } else {
+            break;
+        }
+    }
+
+    if (argc - argIdx < 2) {
+        printf("usage: %s [-cache] [-j threads] il_dir out_dir\n"
+               "  Compiles all .bin IL shaders in il_dir to .spv files in out_dir. Other .bin files,\n"
+               "  such as the SPIR-V written by GRVK_DUMP_SHADERS, are skipped.\n"
+               "  With -cache, writes shader cache entries to out_dir instead, suitable for\n"
+               "  GRVK_SHADER_CACHE_PATH.\n"
+               "  Prints batch time, throughput, IL instruction and SPIR-V word totals.\n",
+               args[0]);
+        return 1;
+    }
+
+    ctx.inDir = args[argIdx];
+    ctx.outDir = args[argIdx + 1];
+    CreateDirectoryA(ctx.outDir, NULL);
+
+    if (ctx.cache) {
+        char env[PATH_LEN];
+        snprintf(env, PATH_LEN, "GRVK_SHADER_CACHE_PATH=%s", ctx.outDir);
+        _putenv(env);
+    }
+
+    if (threadCount == 0) {
+        SYSTEM_INFO systemInfo;
+        GetSystemInfo(&systemInfo);
+        threadCount = systemInfo.dwNumberOfProcessors;
+    }
+    threadCount = threadCount > MAX_THREADS ? MAX_THREADS : threadCount;
+
+    listFiles(&ctx);
+
+    LARGE_INTEGER frequency, start, end;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&start);
+
+    HANDLE threads[MAX_THREADS];
+    for (unsigned i = 0; i < threadCount; i++) {
+        threads[i] = CreateThread(NULL, 0, workerThread, &ctx, 0, NULL);
+        assert(threads[i] != NULL);
+    }
+    for (unsigned i = 0; i < threadCount; i++) {
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+    }
+
+    QueryPerformanceCounter(&end);
+
+    double totalMs = (double)(end.QuadPart - start.QuadPart) * 1e3 / frequency.QuadPart;
+    unsigned instrCount = countInstructions(&ctx);
+
+    printf("compiled %u shaders with %u threads, %ld failed\n",
+           ctx.fileCount - ctx.failCount, threadCount, ctx.failCount);
+    if (ctx.fileCount > 0) {
+        printf("%.1f ms total, %.3f ms per shader, %.1f shaders/s\n",
+               totalMs, totalMs / ctx.fileCount, ctx.fileCount * 1e3 / totalMs);
+        printf("%u IL instructions, %ld SPIR-V words\n", instrCount, ctx.wordCount);
+    }
+
+    for (unsigned i = 0; i < ctx.fileCount; i++) {
+        free(ctx.fileNames[i]);
+    }
+    free(ctx.fileNames);
+
+    return ctx.failCount > 0 ? 1 : 0;
+}